@@ -0,0 +1,53 @@
+#ifndef UNDISTORTLUT_H
+#define UNDISTORTLUT_H
+
+#include <boost/shared_ptr.hpp>
+#include <eigen3/Eigen/Dense>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+#include "Camera.h"
+
+namespace camodocal
+{
+
+/**
+ * \brief Per-pixel lookup table of Camera::liftProjective
+ *
+ * Every pixel of the image is lifted once to normalised image coordinates
+ * (x/z, y/z); sub-pixel queries are answered by bilinear interpolation.
+ * Points outside the table fall back to the camera model.
+ */
+class UndistortLUT
+{
+    public:
+    UndistortLUT( );
+    explicit UndistortLUT( const CameraConstPtr& camera );
+
+    void build( const CameraConstPtr& camera );
+    bool empty( void ) const;
+
+    // Lift a point to the normalised image plane (z = 1)
+    void liftNormalized( const Eigen::Vector2d& p, Eigen::Vector2d& xy ) const;
+    //%output xy
+
+    // Same as liftNormalized, with the result written as (x, y, 1)
+    void liftProjective( const Eigen::Vector2d& p, Eigen::Vector3d& P ) const;
+    //%output P
+
+    // Batched lift for the feature trackers
+    void liftNormalized( const std::vector< cv::Point2f >& pts,
+                         std::vector< cv::Point2f >& un_pts ) const;
+    //%output un_pts
+
+    private:
+    bool lookup( double u, double v, Eigen::Vector2d& xy ) const;
+
+    CameraConstPtr m_camera;
+    cv::Mat m_map; // CV_32FC2, normalised (x, y) of every pixel
+};
+
+typedef boost::shared_ptr< UndistortLUT > UndistortLUTPtr;
+}
+
+#endif
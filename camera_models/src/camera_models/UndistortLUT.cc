@@ -0,0 +1,96 @@
+#include "camodocal/camera_models/UndistortLUT.h"
+
+#include <algorithm>
+
+namespace camodocal
+{
+
+UndistortLUT::UndistortLUT( )
+{
+}
+
+UndistortLUT::UndistortLUT( const CameraConstPtr& camera )
+{
+    build( camera );
+}
+
+void
+UndistortLUT::build( const CameraConstPtr& camera )
+{
+    m_camera = camera;
+
+    int width  = camera->imageWidth( );
+    int height = camera->imageHeight( );
+    m_map.create( height, width, CV_32FC2 );
+
+    for ( int v = 0; v < height; ++v )
+    {
+        cv::Vec2f* row = m_map.ptr< cv::Vec2f >( v );
+        for ( int u = 0; u < width; ++u )
+        {
+            Eigen::Vector3d P;
+            camera->liftProjective( Eigen::Vector2d( u, v ), P );
+            row[u] = cv::Vec2f( P( 0 ) / P( 2 ), P( 1 ) / P( 2 ) );
+        }
+    }
+}
+
+bool
+UndistortLUT::empty( void ) const
+{
+    return m_map.empty( );
+}
+
+bool
+UndistortLUT::lookup( double u, double v, Eigen::Vector2d& xy ) const
+{
+    if ( m_map.empty( ) || u < 0.0 || v < 0.0 || u > m_map.cols - 1 || v > m_map.rows - 1 )
+        return false;
+
+    int u0 = std::min( static_cast< int >( u ), m_map.cols - 2 );
+    int v0 = std::min( static_cast< int >( v ), m_map.rows - 2 );
+    float a = u - u0;
+    float b = v - v0;
+
+    const cv::Vec2f* r0 = m_map.ptr< cv::Vec2f >( v0 );
+    const cv::Vec2f* r1 = m_map.ptr< cv::Vec2f >( v0 + 1 );
+    cv::Vec2f top    = r0[u0] * ( 1.0f - a ) + r0[u0 + 1] * a;
+    cv::Vec2f bottom = r1[u0] * ( 1.0f - a ) + r1[u0 + 1] * a;
+    cv::Vec2f res    = top * ( 1.0f - b ) + bottom * b;
+
+    xy << res[0], res[1];
+    return true;
+}
+
+void
+UndistortLUT::liftNormalized( const Eigen::Vector2d& p, Eigen::Vector2d& xy ) const
+{
+    if ( lookup( p( 0 ), p( 1 ), xy ) )
+        return;
+
+    Eigen::Vector3d P;
+    m_camera->liftProjective( p, P );
+    xy << P( 0 ) / P( 2 ), P( 1 ) / P( 2 );
+}
+
+void
+UndistortLUT::liftProjective( const Eigen::Vector2d& p, Eigen::Vector3d& P ) const
+{
+    Eigen::Vector2d xy;
+    liftNormalized( p, xy );
+    P << xy( 0 ), xy( 1 ), 1.0;
+}
+
+void
+UndistortLUT::liftNormalized( const std::vector< cv::Point2f >& pts,
+                              std::vector< cv::Point2f >& un_pts ) const
+{
+    un_pts.resize( pts.size( ) );
+    for ( size_t i = 0; i < pts.size( ); ++i )
+    {
+        Eigen::Vector2d xy;
+        liftNormalized( Eigen::Vector2d( pts[i].x, pts[i].y ), xy );
+        un_pts[i] = cv::Point2f( xy( 0 ), xy( 1 ) );
+    }
+}
+}
@@ -0,0 +1,43 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#include <ros/ros.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+void startLoopFusion(ros::NodeHandle &n, const std::string &config_file, bool keyboard_command);
+
+namespace loop_fusion
+{
+
+/**
+ * loop_fusion_node的nodelet版本，和VinsNodelet加载到同一个manager里时关键帧位姿、点云和图像以指针传递。
+ * 配置文件取nodelet的第一个参数，或私有参数config_file
+ */
+class LoopFusionNodelet : public nodelet::Nodelet
+{
+  private:
+    virtual void onInit()
+    {
+        ros::NodeHandle &n = getPrivateNodeHandle();
+        std::string config_file;
+        if (!getMyArgv().empty())
+            config_file = getMyArgv()[0];
+        else if (!n.getParam("config_file", config_file))
+        {
+            NODELET_ERROR("please set the config file: nodelet load loop_fusion/LoopFusionNodelet [manager] [config file]");
+            return;
+        }
+        startLoopFusion(n, config_file, false);
+    }
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(loop_fusion::LoopFusionNodelet, nodelet::Nodelet)
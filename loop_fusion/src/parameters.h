@@ -14,6 +14,7 @@
 #include "camodocal/camera_models/CameraFactory.h"
 #include "camodocal/camera_models/CataCamera.h"
 #include "camodocal/camera_models/PinholeCamera.h"
+#include "camodocal/camera_models/UndistortLUT.h"
 #include <eigen3/Eigen/Dense>
 #include <ros/ros.h>
 #include <sensor_msgs/Image.h>
@@ -22,6 +23,7 @@
 #include <cv_bridge/cv_bridge.h>
 
 extern camodocal::CameraPtr m_camera;
+extern camodocal::UndistortLUTPtr m_lut;
 extern Eigen::Vector3d tic;
 extern Eigen::Matrix3d qic;
 extern ros::Publisher pub_match_img;
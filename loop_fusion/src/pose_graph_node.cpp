@@ -58,6 +58,7 @@ int COL;
 int DEBUG_IMAGE;
 
 camodocal::CameraPtr m_camera;
+camodocal::UndistortLUTPtr m_lut;
 Eigen::Vector3d tic;
 Eigen::Matrix3d qic;
 ros::Publisher pub_match_img;
@@ -306,21 +307,12 @@ void process()
                 skip_cnt = 0;
             }
 
+            // KeyFrame会clone图像，这里直接共享消息的内存
             cv_bridge::CvImageConstPtr ptr;
-            if (image_msg->encoding == "8UC1")
-            {
-                sensor_msgs::Image img;
-                img.header = image_msg->header;
-                img.height = image_msg->height;
-                img.width = image_msg->width;
-                img.is_bigendian = image_msg->is_bigendian;
-                img.step = image_msg->step;
-                img.data = image_msg->data;
-                img.encoding = "mono8";
-                ptr = cv_bridge::toCvCopy(img, sensor_msgs::image_encodings::MONO8);
-            }
+            if (image_msg->encoding == sensor_msgs::image_encodings::TYPE_8UC1)
+                ptr = cv_bridge::toCvShare(image_msg, sensor_msgs::image_encodings::TYPE_8UC1);
             else
-                ptr = cv_bridge::toCvCopy(image_msg, sensor_msgs::image_encodings::MONO8);
+                ptr = cv_bridge::toCvShare(image_msg, sensor_msgs::image_encodings::MONO8);
             
             cv::Mat image = ptr->image;
             // build keyframe
@@ -397,10 +389,12 @@ void command()
     }
 }
 
-int main(int argc, char **argv)
+/**
+ * 读取配置、加载词典和位姿图、注册话题并启动处理线程，loop_fusion_node和LoopFusionNodelet共用。
+ * nodelet没有自己的终端，不启动键盘命令线程
+ */
+void startLoopFusion(ros::NodeHandle &n, const string &config_file, bool keyboard_command)
 {
-    ros::init(argc, argv, "loop_fusion");
-    ros::NodeHandle n("~");
     posegraph.registerPub(n);
     
     VISUALIZATION_SHIFT_X = 0;
@@ -408,16 +402,7 @@ int main(int argc, char **argv)
     SKIP_CNT = 0;
     SKIP_DIS = 0;
 
-    if(argc != 2)
-    {
-        printf("please intput: rosrun loop_fusion loop_fusion_node [config file] \n"
-               "for example: rosrun loop_fusion loop_fusion_node "
-               "/home/tony-ws1/catkin_ws/src/VINS-Fusion/config/euroc/euroc_stereo_imu_config.yaml \n");
-        return 0;
-    }
-    
-    string config_file = argv[1];
-    printf("config_file: %s\n", argv[1]);
+    printf("config_file: %s\n", config_file.c_str());
     cout << "============================" << endl;
     cv::FileStorage fsSettings(config_file, cv::FileStorage::READ);
     if(!fsSettings.isOpened())
@@ -448,6 +433,9 @@ int main(int argc, char **argv)
     std::string cam0Path = configPath + "/" + cam0Calib;
     printf("cam calib path: %s\n", cam0Path.c_str());
     m_camera = camodocal::CameraFactory::instance()->generateCameraFromYamlFile(cam0Path.c_str());
+    int USE_UNDISTORT_LUT = fsSettings["undistort_lut"];
+    if (USE_UNDISTORT_LUT)
+        m_lut.reset(new camodocal::UndistortLUT(m_camera));
 
     fsSettings["image0_topic"] >> IMAGE_TOPIC;        
     fsSettings["pose_graph_save_path"] >> POSE_GRAPH_SAVE_PATH;
@@ -478,12 +466,13 @@ int main(int argc, char **argv)
         load_flag = 1;
     }
 
-    ros::Subscriber sub_vio = n.subscribe("/vins_estimator/odometry", 2000, vio_callback);
-    ros::Subscriber sub_image = n.subscribe(IMAGE_TOPIC, 2000, image_callback);
-    ros::Subscriber sub_pose = n.subscribe("/vins_estimator/keyframe_pose", 2000, pose_callback);
-    ros::Subscriber sub_extrinsic = n.subscribe("/vins_estimator/extrinsic", 2000, extrinsic_callback);
-    ros::Subscriber sub_point = n.subscribe("/vins_estimator/keyframe_point", 2000, point_callback);
-    ros::Subscriber sub_margin_point = n.subscribe("/vins_estimator/margin_cloud", 2000, margin_point_callback);
+    static ros::Subscriber sub_vio, sub_image, sub_pose, sub_extrinsic, sub_point, sub_margin_point;
+    sub_vio = n.subscribe("/vins_estimator/odometry", 2000, vio_callback);
+    sub_image = n.subscribe(IMAGE_TOPIC, 2000, image_callback);
+    sub_pose = n.subscribe("/vins_estimator/keyframe_pose", 2000, pose_callback);
+    sub_extrinsic = n.subscribe("/vins_estimator/extrinsic", 2000, extrinsic_callback);
+    sub_point = n.subscribe("/vins_estimator/keyframe_point", 2000, point_callback);
+    sub_margin_point = n.subscribe("/vins_estimator/margin_cloud", 2000, margin_point_callback);
 
     pub_match_img = n.advertise<sensor_msgs::Image>("match_image", 1000);
     pub_camera_pose_visual = n.advertise<visualization_msgs::MarkerArray>("camera_pose_visual", 1000);
@@ -491,13 +480,32 @@ int main(int argc, char **argv)
     pub_margin_cloud = n.advertise<sensor_msgs::PointCloud>("margin_cloud_loop_rect", 1000);
     pub_odometry_rect = n.advertise<nav_msgs::Odometry>("odometry_rect", 1000);
 
-    std::thread measurement_process;
-    std::thread keyboard_command_process;
+    std::thread measurement_process(process);
+    measurement_process.detach();
+    if (keyboard_command)
+    {
+        std::thread keyboard_command_process(command);
+        keyboard_command_process.detach();
+    }
+}
+
+#ifndef LOOP_FUSION_NODELET
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "loop_fusion");
+    ros::NodeHandle n("~");
 
-    measurement_process = std::thread(process);
-    keyboard_command_process = std::thread(command);
-    
+    if(argc != 2)
+    {
+        printf("please intput: rosrun loop_fusion loop_fusion_node [config file] \n"
+               "for example: rosrun loop_fusion loop_fusion_node "
+               "/home/tony-ws1/catkin_ws/src/VINS-Fusion/config/euroc/euroc_stereo_imu_config.yaml \n");
+        return 0;
+    }
+
+    startLoopFusion(n, argv[1], true);
     ros::spin();
 
     return 0;
 }
+#endif
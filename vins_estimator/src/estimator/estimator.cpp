@@ -45,6 +45,17 @@ void Estimator::clearState()
     initP = Eigen::Vector3d(0, 0, 0);
     initR = Eigen::Matrix3d::Identity();
     inputImageCnt = 0;
+    resetQueuedFrame = true;
+    frameSkipCnt = 0;
+    frameDropCnt = 0;
+    frameQueueDepth = 0;
+    frameQueueMaxDepth = 0;
+    mPredict.lock();
+    predictLandmarks.clear();
+    predictRemoveIds.clear();
+    predictLineLandmarks.clear();
+    predictNonLinear = false;
+    mPredict.unlock();
     initFirstPoseFlag = false;
 
     for (int i = 0; i < WINDOW_SIZE + 1; i++)
@@ -87,6 +98,7 @@ void Estimator::clearState()
     tmp_pre_integration = nullptr;
     last_marginalization_info = nullptr;
     last_marginalization_parameter_blocks.clear();
+    window_problem.reset();
 
     f_manager.clearState();
 
@@ -105,6 +117,7 @@ void Estimator::setParameter()
         cout << " exitrinsic cam " << i << endl  << ric[i] << endl << tic[i].transpose() << endl;
     }
     f_manager.setRic(ric);
+    // 视觉因子的信息矩阵是静态成员，只在这里设置，Evaluate只读，多线程求解时可重入
     ProjectionTwoFrameOneCamFactor::sqrt_info = FOCAL_LENGTH / 1.5 * Matrix2d::Identity();
     ProjectionTwoFrameTwoCamFactor::sqrt_info = FOCAL_LENGTH / 1.5 * Matrix2d::Identity();
     ProjectionOneFrameTwoCamFactor::sqrt_info = FOCAL_LENGTH / 1.5 * Matrix2d::Identity();
@@ -115,7 +128,16 @@ void Estimator::setParameter()
     cout << "set g " << g.transpose() << endl;
     featureTracker.readIntrinsicParameter(CAM_NAMES);
 
-    linefeatureTracker.readIntrinsicParameter(CAM_NAMES[0]);
+    linefeatureTracker.readIntrinsicParameter(CAM_NAMES);
+    if (!linefeatureTracker.detector_)   // 重启时线程池里可能正在检测，只建一次
+    {
+        linefeatureTracker.detector_ = LineDetector::create(LINE_DETECTOR, LINE_DETECT_TILES);
+        ROS_INFO("line detector: %s", linefeatureTracker.detector_->name().c_str());   // 分块时如LSDx4
+    }
+    if (line_track_pool.size() == 0)
+        line_track_pool.resize(1);
+    if (SHOW_LINE_TRACK > 0)
+        linefeatureTracker.setMatchImageCallback(pubLineTrackImage);
 
     std::cout << "MULTIPLE_THREAD is " << MULTIPLE_THREAD << '\n';
     
@@ -158,6 +180,7 @@ void Estimator::changeSensorType(int use_imu, int use_stereo)
         printf("use imu %d use stereo %d\n", USE_IMU, STEREO);
     }
     mProcess.unlock();
+    conBuf.notify_one();
     if(restart)
     {
         clearState();
@@ -174,21 +197,23 @@ void Estimator::changeSensorType(int use_imu, int use_stereo)
 void Estimator::inputImage(double t, const cv::Mat &_img, const cv::Mat &_img1)
 {
     inputImageCnt++;
-    map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> featureFrame;
-    map<int, vector<pair<int,  Eigen::Matrix<double, 4, 1>>>> linefeatureFrame;
+    FeatureFramePtr featureFrame = std::make_shared<FeatureFrame>();
 
     TicToc featureTrackerTime;
 
-    if(_img1.empty())
-    {
-        featureFrame = featureTracker.trackImage(t, _img);//追踪单目
-        linefeatureFrame = linefeatureTracker.trackImage(t, _img);
-    }
-    else
-    {
-        featureFrame = featureTracker.trackImage(t, _img, _img1);//追踪双目
-        linefeatureFrame = linefeatureTracker.trackImage(t, _img, _img1);
-    }
+    if (MULTIPLE_THREAD)
+        predictPtsWithIMU();
+    // 点、线跟踪只共用输入图像，分别写FeatureFrame中点和线的部分，可以同时进行
+    if (LINE_PREDICT_MATCH)
+        predictLinesWithIMU();
+    std::future<void> line_job = line_track_pool.enqueue([&]()
+    {
+        linefeatureTracker.trackImage(t, _img, _img1, *featureFrame);
+    });
+    featureTracker.trackImage(t, _img, _img1, *featureFrame);      // _img1为空时追踪单目
+    line_job.get();
+    featureFrame->t = t;
+    featureFrame->sortById();
 
     if (SHOW_TRACK)
     {
@@ -198,19 +223,41 @@ void Estimator::inputImage(double t, const cv::Mat &_img, const cv::Mat &_img1)
     
     if(MULTIPLE_THREAD)  
     {     
-        if(inputImageCnt % 2 == 0)
+        // 后端跟得上时每帧都送入；featureBuf积压到FRAME_QUEUE_SIZE后只送关键帧候选，
+        // 到2倍FRAME_QUEUE_SIZE时新的候选帧替换队尾的帧，队列不再增长(后端只读队首，队尾可以直接换)
+        if (resetQueuedFrame.exchange(false))
+            lastQueuedFrame.reset();
+        mBuf.lock();
+        bool full = (int)featureBuf.size() >= FRAME_QUEUE_SIZE;
+        mBuf.unlock();
+        if (!full || isKeyframeCandidate(*featureFrame))
         {
+            lastQueuedFrame = featureFrame;
             mBuf.lock();
-            featureBuf.push(make_pair(t, featureFrame));
-            linefeatureBuf.push(make_pair(t, linefeatureFrame));
+            if ((int)featureBuf.size() >= 2 * FRAME_QUEUE_SIZE)
+            {
+                frameDropCnt++;
+                ROS_DEBUG("frame queue full, replace frame %f with %f", featureBuf.back()->t, t);
+                featureBuf.back() = std::move(featureFrame);
+            }
+            else
+                featureBuf.push(std::move(featureFrame));
+            frameQueueDepth = featureBuf.size();
+            if (frameQueueDepth > frameQueueMaxDepth)
+                frameQueueMaxDepth = frameQueueDepth.load();
             mBuf.unlock();
+            conBuf.notify_one();
+        }
+        else
+        {
+            frameSkipCnt++;
+            ROS_DEBUG("backend busy, skip frame %f (%d skipped of %d)", t, frameSkipCnt.load(), inputImageCnt);
         }
     }
     else
     {
         mBuf.lock();
-        featureBuf.push(make_pair(t, featureFrame));
-        linefeatureBuf.push(make_pair(t, linefeatureFrame));
+        featureBuf.push(std::move(featureFrame));
         mBuf.unlock();
         TicToc processTime;
         processMeasurements();
@@ -218,6 +265,41 @@ void Estimator::inputImage(double t, const cv::Mat &_img, const cv::Mat &_img1)
     }
 }
 
+/**
+ * 前端用的关键帧判断，与addFeatureCheckParallax的准则一致：
+ * 和上一个送入后端的帧相比，跟踪上的点太少、新点太多或平均视差足够大
+ */
+bool Estimator::isKeyframeCandidate(const FeatureFrame &frame)
+{
+    if (!lastQueuedFrame)
+        return true;
+    const FeatureFrame &ref = *lastQueuedFrame;
+
+    int left_num = 0, track_num = 0;
+    double parallax_sum = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < frame.pointSize(); i++)
+    {
+        if (frame.cam_ids[i] != 0)
+            continue;
+        left_num++;
+        while (j < ref.pointSize() && (ref.ids[j] < frame.ids[i] || ref.cam_ids[j] != 0))
+            j++;
+        if (j < ref.pointSize() && ref.ids[j] == frame.ids[i])
+        {
+            track_num++;
+            double du = frame.x[i] - ref.x[j];
+            double dv = frame.y[i] - ref.y[j];
+            parallax_sum += sqrt(du * du + dv * dv);
+        }
+    }
+
+    int new_num = left_num - track_num;
+    if (track_num < 20 || new_num > 0.5 * track_num)
+        return true;
+    return parallax_sum / track_num >= MIN_PARALLAX;
+}
+
 void Estimator::inputIMU(double t, const Vector3d &linearAcceleration, const Vector3d &angularVelocity)
 {
     mBuf.lock();
@@ -225,17 +307,28 @@ void Estimator::inputIMU(double t, const Vector3d &linearAcceleration, const Vec
     gyrBuf.push(make_pair(t, angularVelocity));
     //printf("input imu with time %f \n", t);
     mBuf.unlock();
+    conBuf.notify_one();
 
+    mPropagate.lock();
     fastPredictIMU(t, linearAcceleration, angularVelocity);
     if (solver_flag == NON_LINEAR)
         pubLatestOdometry(latest_P, latest_Q, latest_V, t);
+    mPropagate.unlock();
 }
 
 void Estimator::inputFeature(double t, const map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> &featureFrame)
 {
+    FeatureFramePtr frame = std::make_shared<FeatureFrame>();
+    frame->t = t;
+    frame->reservePoints(featureFrame.size() * 2);
+    for (auto &id_pts : featureFrame)
+        for (auto &cam_pt : id_pts.second)
+            frame->addPoint(id_pts.first, cam_pt.first, cam_pt.second);
+
     mBuf.lock();
-    featureBuf.push(make_pair(t, featureFrame));
+    featureBuf.push(std::move(frame));
     mBuf.unlock();
+    conBuf.notify_one();
 
     if(!MULTIPLE_THREAD)
         processMeasurements();
@@ -294,36 +387,36 @@ void Estimator::processMeasurements()
     while (1)
     {
         // printf("process measurments\n");
-        pair<double, map<int, vector<pair<int, Eigen::Matrix<double, 8, 1> > > > > feature;
-        pair<double, map<int, vector<pair<int, Eigen::Matrix<double, 4, 1> > > > > linefeature;
+        FeatureFramePtr feature;
 
         
         vector<pair<double, Eigen::Vector3d>> accVector, gyrVector;
-        if(!featureBuf.empty() && !linefeatureBuf.empty())
+        if (MULTIPLE_THREAD)
+        {
+            // 阻塞到有新帧、且该帧时刻之前的IMU都已到达
+            std::unique_lock<std::mutex> lock(mBuf);
+            conBuf.wait(lock, [&]
+                        {
+                return !featureBuf.empty() && (!USE_IMU || IMUAvailable(featureBuf.front()->t + td));
+                        });
+        }
+        if(!featureBuf.empty())
         {
             feature = featureBuf.front();
-            linefeature = linefeatureBuf.front(); 
 
-            curTime = feature.first + td;
-            while(1)
+            curTime = feature->t + td;
+            if (USE_IMU && !IMUAvailable(feature->t + td))
             {
-                if ((!USE_IMU  || IMUAvailable(feature.first + td)))
-                    break;
-                else
-                {
-                    printf("wait for imu ... \n");
-                    if (! MULTIPLE_THREAD)
-                        return;
-                    std::chrono::milliseconds dura(5);
-                    std::this_thread::sleep_for(dura);
-                }
+                // 单线程模式，留到下一帧图像输入时再处理
+                printf("wait for imu ... \n");
+                return;
             }
             mBuf.lock();
             if(USE_IMU)
                 getIMUInterval(prevTime, curTime, accVector, gyrVector);
 
             featureBuf.pop();
-            linefeatureBuf.pop();
+            frameQueueDepth = featureBuf.size();
             mBuf.unlock();
 
             if(USE_IMU)
@@ -343,14 +436,14 @@ void Estimator::processMeasurements()
                 }
             }
             mProcess.lock();
-            processImage(feature.second, linefeature.second, feature.first);
+            processImage(*feature, feature->t);
             prevTime = curTime;
 
             printStatistics(*this, 0);
 
             std_msgs::Header header;
             header.frame_id = "world";
-            header.stamp = ros::Time(feature.first);
+            header.stamp = ros::Time(feature->t);
 
             pubOdometry(*this, header);
             pubKeyPoses(*this, header);
@@ -364,9 +457,6 @@ void Estimator::processMeasurements()
 
         if (! MULTIPLE_THREAD)
             break;
-
-        std::chrono::milliseconds dura(2);
-        std::this_thread::sleep_for(dura);
     }
 }
 
@@ -438,16 +528,16 @@ void Estimator::processIMU(double t, double dt, const Vector3d &linear_accelerat
 }
 
 
-void Estimator::processImage(const map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> &image, 
-                             const map<int, vector<pair<int, Vector4d>>> &lines, 
-                             const double header)
+void Estimator::processImage(const FeatureFrame &frame, const double header)
 {
     ROS_DEBUG("new image coming -------");
-    ROS_DEBUG("Adding feature points %lu", image.size());
+    ROS_DEBUG("Adding feature points %lu", frame.pointSize());
 
-    if (f_manager.addFeatureCheckParallax(frame_count, image, lines, td))
+    if (f_manager.addFeatureCheckParallax(frame_count, frame, td))
     {
         marginalization_flag = MARGIN_OLD;
+        if (LINE_KLT_TRACK)   // 关键帧，前端下一帧重新检测线
+            linefeatureTracker.requestDetection();
     }
     else
     {
@@ -458,7 +548,12 @@ void Estimator::processImage(const map<int, vector<pair<int, Eigen::Matrix<doubl
     ROS_DEBUG("number of feature: %d", f_manager.getFeatureCount());
     Headers[frame_count] = header;
 
-    ImageFrame imageframe(image, header);
+    // 只有初始化(PnP、视觉惯性对齐)需要ImageFrame中的特征点
+    ImageFrame imageframe;
+    imageframe.t = header;
+    imageframe.is_key_frame = false;
+    if (solver_flag == INITIAL)
+        imageframe.points = frame.toPointMap();
     imageframe.pre_integration = tmp_pre_integration;
     all_image_frame.insert(make_pair(header, imageframe));
     tmp_pre_integration = new IntegrationBase{acc_0, gyr_0, Bas[frame_count], Bgs[frame_count]};
@@ -570,6 +665,8 @@ void Estimator::processImage(const map<int, vector<pair<int, Eigen::Matrix<doubl
         if(!USE_IMU)
         f_manager.initFramePoseByPnP(frame_count, Ps, Rs, tic, ric);
         f_manager.triangulate(frame_count, Ps, Rs, tic, ric);
+        if (STEREO && STEREO_LINE)
+            f_manager.triangulateStereoLine(tic, ric);
         f_manager.triangulateLine(Ps, tic, ric);
         optimizationwithLine();
 
@@ -590,6 +687,10 @@ void Estimator::processImage(const map<int, vector<pair<int, Eigen::Matrix<doubl
             featureTracker.removeOutliers(removeIndex);
             predictPtsInNextFrame();
         }
+        else
+            updatePredictLandmarks(removeIndex);
+        if (LINE_PREDICT_MATCH)
+            updatePredictLines();
         if (failureDetection())
         {
             ROS_WARN("failure detection!");
@@ -645,7 +746,7 @@ void  Estimator::onlyLineOpt()
     for (auto &it_per_id : f_manager.linefeature)
     {
         it_per_id.used_num = it_per_id.linefeature_per_frame.size();                // 已经被多少帧观测到， 这个已经在三角化那个函数里说了
-        if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))  // 如果这个特征才被观测到，那就跳过。实际上这里为啥不直接用如果特征没有三角化这个条件。
+        if (!it_per_id.isSolvable())  // 如果这个特征才被观测到，那就跳过。实际上这里为啥不直接用如果特征没有三角化这个条件。
             continue;
 
         ++feature_index;            // 这个变量会记录feature在 para_Feature 里的位置， 将深度存入para_Feature时索引的记录也是用的这种方式
@@ -684,6 +785,7 @@ void  Estimator::onlyLineOpt()
     options.linear_solver_type = ceres::DENSE_SCHUR;
     // options.trust_region_strategy_type = ceres::DOGLEG;
     options.max_num_iterations = NUM_ITERATIONS;
+    options.num_threads = NUM_SOLVER_THREADS;
     ceres::Solver::Summary summary;
     ceres::Solve (options, &problem, & summary);
 
@@ -692,58 +794,48 @@ void  Estimator::onlyLineOpt()
     f_manager.removeLineOutlier(Ps,tic,ric);
 }
 
-//#define DebugFactor
-void Estimator::optimizationwithLine()
+// 两个arena轮流用：新的MarginalizationInfo建好之前，上一个的先验还要用
+FrameArena *Estimator::marginalizationArena()
 {
-    TicToc t_whole, t_prepare;
-    vector2double();
+    FrameArena *arena = &marginalization_arena[0];
+    if (last_marginalization_info && last_marginalization_info->arena == arena)
+        arena = &marginalization_arena[1];
+    arena->reset();
+    return arena;
+}
 
-    ceres::Problem problem;
-    ceres::LossFunction *loss_function;
-    //loss_function = NULL;
-    loss_function = new ceres::HuberLoss(1.0); // 鲁邦核函数
-    //loss_function = new ceres::CauchyLoss(1.0 / FOCAL_LENGTH);
-    //ceres::LossFunction* loss_function = new ceres::HuberLoss(1.0);
-    for (int i = 0; i < frame_count + 1; i++) // 将窗口内的 p,q 加入优化变量
+/**
+ * 滑窗优化的参数块和残差只在这里枚举一次，problem为常驻的WindowProblem或每帧新建的FrameProblem。
+ * 帧参数按时间戳、路标按feature_id作为key，WindowProblem按key保留上一帧已有的残差，FrameProblem忽略key。
+ * 路标的遍历顺序和vector2double一致，para_Feature/para_LineFeature的下标不变
+ */
+template <typename Problem>
+void Estimator::addWindowFactors(Problem &problem)
+{
+    for (int i = 0; i < frame_count + 1; i++)
     {
-        ceres::LocalParameterization *local_parameterization = new PoseLocalParameterization();
-        problem.AddParameterBlock(para_Pose[i], SIZE_POSE, local_parameterization); // p,q SIZE_POSE = 7
+        problem.addParameterBlock(WindowProblem::POSE, Headers[i], para_Pose[i], SIZE_POSE);
+        problem.setConstant(para_Pose[i], !USE_IMU && i == 0);
         if(USE_IMU)
-            problem.AddParameterBlock(para_SpeedBias[i], SIZE_SPEEDBIAS);
+            problem.addParameterBlock(WindowProblem::SPEED_BIAS, Headers[i], para_SpeedBias[i], SIZE_SPEEDBIAS);
     }
-    if(!USE_IMU)
-        problem.SetParameterBlockConstant(para_Pose[0]);
-
     for (int i = 0; i < NUM_OF_CAM; i++)
     {
-        ceres::LocalParameterization *local_parameterization = new PoseLocalParameterization();
-        problem.AddParameterBlock(para_Ex_Pose[i], SIZE_POSE, local_parameterization);
+        problem.addParameterBlock(WindowProblem::EX_POSE, i, para_Ex_Pose[i], SIZE_POSE);
         if ((ESTIMATE_EXTRINSIC && frame_count == WINDOW_SIZE && Vs[0].norm() > 0.2) || openExEstimation)
-        {
-            //ROS_INFO("estimate extinsic param");
             openExEstimation = 1;
-        }
-        else
-        {
-            //ROS_INFO("fix extinsic param");
-            problem.SetParameterBlockConstant(para_Ex_Pose[i]);
-        }
+        problem.setConstant(para_Ex_Pose[i], !openExEstimation);
     }
-    // 时延状态量
-    problem.AddParameterBlock(para_Td[0], 1); 
-
-    if (!ESTIMATE_TD || Vs[0].norm() < 0.2)
-        problem.SetParameterBlockConstant(para_Td[0]);
+    problem.addParameterBlock(WindowProblem::TD, 0, para_Td[0], 1);
+    problem.setConstant(para_Td[0], !ESTIMATE_TD || Vs[0].norm() < 0.2);
 
-    // 添加边缘化状态量到残差
+    // 先验和IMU因子每帧都变，WindowProblem里也是每帧重建
     if (last_marginalization_info && last_marginalization_info->valid)
     {
-        // construct new marginlization_factor
-        MarginalizationFactor *marginalization_factor = new MarginalizationFactor(last_marginalization_info);
-        problem.AddResidualBlock(marginalization_factor, NULL,
-                                 last_marginalization_parameter_blocks);  
+        if (!problem.addResidual(problem.template create<MarginalizationFactor>(last_marginalization_info), NULL,
+                                 last_marginalization_parameter_blocks))
+            ROS_WARN("marginalization prior has blocks outside the window");
     }
-    // IMU Factor
     if(USE_IMU)
     {
         for (int i = 0; i < frame_count; i++)
@@ -751,115 +843,130 @@ void Estimator::optimizationwithLine()
             int j = i + 1;
             if (pre_integrations[j]->sum_dt > 10.0)
                 continue;
-            IMUFactor* imu_factor = new IMUFactor(pre_integrations[j]);
-            problem.AddResidualBlock(imu_factor, NULL, para_Pose[i], para_SpeedBias[i], para_Pose[j], para_SpeedBias[j]);
+            problem.addResidual(problem.template create<IMUFactor>(pre_integrations[j]), NULL,
+                                {para_Pose[i], para_SpeedBias[i], para_Pose[j], para_SpeedBias[j]});
         }
     }
-    // Feature Factor 特征点因子
-    int f_m_cnt = 0;
+
+    // 观测不会变，点的残差由(起始帧, 观测帧, 类型)确定
     int feature_index = -1;
     for (auto &it_per_id : f_manager.feature)
     {
         it_per_id.used_num = it_per_id.feature_per_frame.size();
         if (it_per_id.used_num < 4)
             continue;
- 
+
         ++feature_index;
+        double *depth = para_Feature[feature_index];
+        problem.addParameterBlock(WindowProblem::POINT, it_per_id.feature_id, depth, SIZE_FEATURE);
 
-        // imu_i该特征点第一次被观测到的帧 ,imu_j = imu_i - 1
+        // imu_i该特征点第一次被观测到的帧
         int imu_i = it_per_id.start_frame, imu_j = imu_i - 1;
-        
-        Vector3d pts_i = it_per_id.feature_per_frame[0].point;
-
-        // 拿出每帧的 特征点
+        const FeaturePerFrame &frame_i = it_per_id.feature_per_frame[0];
         for (auto &it_per_frame : it_per_id.feature_per_frame)
         {
             imu_j++;
-            if (imu_i != imu_j) // 本次不是第一次观测到
+            if (imu_i != imu_j)
             {
-                Vector3d pts_j = it_per_frame.point;
-                ProjectionTwoFrameOneCamFactor *f_td = new ProjectionTwoFrameOneCamFactor(pts_i, pts_j, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocity,
-                                                                 it_per_id.feature_per_frame[0].cur_td, it_per_frame.cur_td);
-                problem.AddResidualBlock(f_td, loss_function, para_Pose[imu_i], para_Pose[imu_j], para_Ex_Pose[0], para_Feature[feature_index], para_Td[0]);
+                problem.addLandmarkResidual(depth, WindowProblem::ResidualKey(Headers[imu_i], Headers[imu_j], 0), [&]() {
+                    return problem.template create<ProjectionTwoFrameOneCamFactor>(frame_i.point, it_per_frame.point, frame_i.velocity, it_per_frame.velocity,
+                                                                                  frame_i.cur_td, it_per_frame.cur_td);
+                }, {para_Pose[imu_i], para_Pose[imu_j], para_Ex_Pose[0], depth, para_Td[0]});
             }
-
             if(STEREO && it_per_frame.is_stereo)
-            {                
-                Vector3d pts_j_right = it_per_frame.pointRight;
+            {
                 if(imu_i != imu_j)
                 {
-                    ProjectionTwoFrameTwoCamFactor *f = new ProjectionTwoFrameTwoCamFactor(pts_i, pts_j_right, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocityRight,
-                                                                 it_per_id.feature_per_frame[0].cur_td, it_per_frame.cur_td);
-                    problem.AddResidualBlock(f, loss_function, para_Pose[imu_i], para_Pose[imu_j], para_Ex_Pose[0], para_Ex_Pose[1], para_Feature[feature_index], para_Td[0]);
-                                                            // 前后 两帧 imu_i 和 imu_j = imu_i - 1
+                    problem.addLandmarkResidual(depth, WindowProblem::ResidualKey(Headers[imu_i], Headers[imu_j], 1), [&]() {
+                        return problem.template create<ProjectionTwoFrameTwoCamFactor>(frame_i.point, it_per_frame.pointRight, frame_i.velocity, it_per_frame.velocityRight,
+                                                                                      frame_i.cur_td, it_per_frame.cur_td);
+                    }, {para_Pose[imu_i], para_Pose[imu_j], para_Ex_Pose[0], para_Ex_Pose[1], depth, para_Td[0]});
                 }
                 else
                 {
-                    ProjectionOneFrameTwoCamFactor *f = new ProjectionOneFrameTwoCamFactor(pts_i, pts_j_right, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocityRight,
-                                                                 it_per_id.feature_per_frame[0].cur_td, it_per_frame.cur_td);
-                    problem.AddResidualBlock(f, loss_function, para_Ex_Pose[0], para_Ex_Pose[1], para_Feature[feature_index], para_Td[0]);
+                    problem.addLandmarkResidual(depth, WindowProblem::ResidualKey(Headers[imu_i], Headers[imu_j], 2), [&]() {
+                        return problem.template create<ProjectionOneFrameTwoCamFactor>(frame_i.point, it_per_frame.pointRight, frame_i.velocity, it_per_frame.velocityRight,
+                                                                                      frame_i.cur_td, it_per_frame.cur_td);
+                    }, {para_Ex_Pose[0], para_Ex_Pose[1], depth, para_Td[0]});
                 }
             }
-            f_m_cnt++;
-
-            // std::cout << "1 -------------it_per_frame.feature_per_frame.size()  is " << it_per_frame.point.size() << std::endl;
-
         }
-
     }
-    
-    ///////////////////////  START  //////////////
-    int line_m_cnt = 0;
+
+    // 直线参数在世界系下，残差只和观测帧、相机有关；起始帧的左目残差是否加入每帧重新判断
     int linefeature_index = -1;
     for (auto &it_per_id : f_manager.linefeature)
     {
-        it_per_id.used_num = it_per_id.linefeature_per_frame.size();  // 已经被多少帧观测到
-        if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))  
+        it_per_id.used_num = it_per_id.linefeature_per_frame.size();   // 已经被多少帧观测到
+        if (!it_per_id.isSolvable())
             continue;
 
-        ++linefeature_index; // 这个变量会记录feature在 para_Feature 里的位置， 将深度存入para_Feature时索引的记录也是用的这种方式
-
-        ceres::LocalParameterization *local_parameterization_line = new LineOrthParameterization();
-        problem.AddParameterBlock( para_LineFeature[linefeature_index], SIZE_LINE, local_parameterization_line);  // p,q
-
-        // imu_i该特征点第一次被观测到的帧 ,imu_j = imu_i - 1
-        int imu_i = it_per_id.start_frame,imu_j = imu_i - 1;
+        ++linefeature_index;
+        double *line = para_LineFeature[linefeature_index];
+        problem.addParameterBlock(WindowProblem::LINE, it_per_id.feature_id, line, SIZE_LINE);
 
+        int imu_i = it_per_id.start_frame, imu_j = imu_i - 1;
         for (auto &it_per_frame : it_per_id.linefeature_per_frame)
         {
             imu_j++;
-            if (imu_i == imu_j) // 第一次观测到
+            if (imu_i != imu_j || it_per_frame.is_stereo)   // 第一次观测到的帧只有双目时才加入，和右目一起约束直线
             {
-                continue;
+                problem.addLandmarkResidual(line, WindowProblem::ResidualKey(Headers[imu_j], 0, 0), [&]() {
+                    return problem.template create<lineProjectionFactor>(it_per_frame.lineobs);
+                }, {para_Pose[imu_j], para_Ex_Pose[0], line});
+            }
+            if(STEREO && it_per_frame.is_stereo)
+            {
+                problem.addLandmarkResidual(line, WindowProblem::ResidualKey(Headers[imu_j], 0, 1), [&]() {
+                    return problem.template create<lineProjectionFactor>(it_per_frame.lineobs_R);   // 右目观测
+                }, {para_Pose[imu_j], para_Ex_Pose[1], line});
             }
-            Vector4d obs = it_per_frame.lineobs;                          // 在第j帧图像上的观测
-            lineProjectionFactor *f_line = new lineProjectionFactor(obs); // 特征重投影误差
-            problem.AddResidualBlock(f_line, loss_function,               // 代价函数模块、损失函数模块和参数模块(参数1，参数2...)
-                                     para_Pose[imu_j],                    
-                                     para_Ex_Pose[0],
-                                     para_LineFeature[linefeature_index]);
-            line_m_cnt++; // lineFactor计数
         }
     }
-    // ROS_INFO("lineFactor: %d, pointFactor:%d", line_m_cnt, f_m_cnt);
+}
 
-    // 设置点线权重   --- line_m_cnt 数值越大, line factor 权重越小
-    // if(line_m_cnt > 20)
-    // {
-    //     double scale = std::min(f_m_cnt /(2. * line_m_cnt), 10.);
-    //     lineProjectionFactor::sqrt_info =  scale * FOCAL_LENGTH / 1.5 * Matrix2d::Identity();
-    //     std::cout << "========== Line factor weight ========== \n" << scale  << std::endl; 
-    // }
+/**
+ * 按当前滑窗更新常驻的window_problem：新观测才新建残差，
+ * 被边缘化的帧、剔除的路标的残差在endFrame里删掉
+ */
+void Estimator::updateWindowProblem()
+{
+    window_problem.beginFrame();
+    addWindowFactors(window_problem);
+    window_problem.endFrame();
+    ROS_DEBUG("window problem: %d residuals added, %d removed", window_problem.numAdded(), window_problem.numRemoved());
+}
 
-    //////////////////////////  END  //////////////
+//#define DebugFactor
+void Estimator::optimizationwithLine()
+{
+    TicToc t_whole, t_prepare;
+    vector2double();
 
+    problem_arena.reset();   // 上一帧的局部problem已经析构
+    FrameProblem frame_problem(problem_arena);
+    ceres::LossFunction *loss_function;   // 边缘化时也要用
+    vector<double *> landmarks;           // 点、线路标的参数块
+    if (PERSISTENT_PROBLEM)   // 只增删和上一帧不同的参数块、残差
+    {
+        updateWindowProblem();
+        loss_function = window_problem.lossFunction();
+        landmarks = window_problem.landmarks();
+    }
+    else
+    {
+        addWindowFactors(frame_problem);
+        loss_function = frame_problem.lossFunction();
+        landmarks = frame_problem.landmarks();
+    }
+    ceres::Problem &problem = PERSISTENT_PROBLEM ? window_problem.problem() : frame_problem.problem();
 
     // ROS_DEBUG("visual measurement count: %d", f_m_cnt);
     // ROS_DEBUG("prepare for ceres: %f", t_prepare.toc());
     ceres::Solver::Options options;
 
     options.linear_solver_type = ceres::DENSE_SCHUR;
-    options.num_threads = 1;
+    options.num_threads = NUM_SOLVER_THREADS;
     options.trust_region_strategy_type = ceres::DOGLEG;
     options.max_num_iterations = NUM_ITERATIONS;
     //options.use_explicit_schur_complement = true;
@@ -870,10 +977,25 @@ void Estimator::optimizationwithLine()
     else
         options.max_solver_time_in_seconds = SOLVER_TIME;
     TicToc t_solver;
-    ceres::Solver::Summary summary;
-    ceres::Solve(options, &problem, &summary);
-    //cout << summary.BriefReport() << endl;
-    ROS_DEBUG("Iterations : %d", static_cast<int>(summary.iterations.size()));
+    bool solved = false;
+    if (USE_SCHUR_SOLVER)   // 点、线路标逐个消元，结构不满足时退回ceres
+    {
+        SlidingWindowSolver::Options window_options;
+        window_options.max_num_iterations = options.max_num_iterations;
+        window_options.max_solver_time_in_seconds = options.max_solver_time_in_seconds;
+        SlidingWindowSolver::Summary window_summary;
+        solved = window_solver.solve(problem, landmarks, window_options, &window_summary);
+        if (solved)
+            ROS_DEBUG("Iterations : %d", window_summary.iterations);
+        else
+            ROS_WARN("sliding window solver can not handle the problem, use ceres");
+    }
+    if (!solved)
+    {
+        ceres::Solver::Summary summary;
+        ceres::Solve(options, &problem, &summary);
+        ROS_DEBUG("Iterations : %d", static_cast<int>(summary.iterations.size()));
+    }
     //cout << summary.BriefReport() << endl;
 //    ROS_INFO("Points Lines Iterations : %d", static_cast<int>(summary.iterations.size()));
     // sum_solver_time_ += t_solver.toc();
@@ -882,6 +1004,8 @@ void Estimator::optimizationwithLine()
 
     //double2vector();
 
+    if (PERSISTENT_PROBLEM)
+        window_problem.copyBack();
     double2vector2();   // Line pose change
     TicToc t_culling;
     f_manager.removeLineOutlier(Ps,tic,ric);   // remove Line outlier
@@ -894,7 +1018,7 @@ void Estimator::optimizationwithLine()
     TicToc t_whole_marginalization;
     if (marginalization_flag == MARGIN_OLD)
     {
-        MarginalizationInfo *marginalization_info = new MarginalizationInfo();
+        MarginalizationInfo *marginalization_info = new MarginalizationInfo(marginalizationArena());
         vector2double();
 
         if (last_marginalization_info && last_marginalization_info->valid)
@@ -907,8 +1031,8 @@ void Estimator::optimizationwithLine()
                     drop_set.push_back(i);
             }
             // construct new marginlization_factor
-            MarginalizationFactor *marginalization_factor = new MarginalizationFactor(last_marginalization_info);
-            ResidualBlockInfo *residual_block_info = new ResidualBlockInfo(marginalization_factor, NULL,
+            MarginalizationFactor *marginalization_factor = marginalization_info->create<MarginalizationFactor>(last_marginalization_info);
+            ResidualBlockInfo *residual_block_info = marginalization_info->create<ResidualBlockInfo>(marginalization_factor, nullptr,
                                                                            last_marginalization_parameter_blocks,
                                                                            drop_set);
             marginalization_info->addResidualBlockInfo(residual_block_info);
@@ -918,8 +1042,8 @@ void Estimator::optimizationwithLine()
         {
             if (pre_integrations[1]->sum_dt < 10.0)
             {
-                IMUFactor* imu_factor = new IMUFactor(pre_integrations[1]);
-                ResidualBlockInfo *residual_block_info = new ResidualBlockInfo(imu_factor, NULL,
+                IMUFactor* imu_factor = marginalization_info->create<IMUFactor>(pre_integrations[1]);
+                ResidualBlockInfo *residual_block_info = marginalization_info->create<ResidualBlockInfo>(imu_factor, nullptr,
                                                                            vector<double *>{para_Pose[0], para_SpeedBias[0], para_Pose[1], para_SpeedBias[1]},
                                                                            vector<int>{0, 1});
                 marginalization_info->addResidualBlockInfo(residual_block_info);
@@ -948,9 +1072,9 @@ void Estimator::optimizationwithLine()
                     if(imu_i != imu_j)
                     {
                         Vector3d pts_j = it_per_frame.point;
-                        ProjectionTwoFrameOneCamFactor *f_td = new ProjectionTwoFrameOneCamFactor(pts_i, pts_j, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocity,
+                        ProjectionTwoFrameOneCamFactor *f_td = marginalization_info->create<ProjectionTwoFrameOneCamFactor>(pts_i, pts_j, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocity,
                                                                           it_per_id.feature_per_frame[0].cur_td, it_per_frame.cur_td);
-                        ResidualBlockInfo *residual_block_info = new ResidualBlockInfo(f_td, loss_function,
+                        ResidualBlockInfo *residual_block_info = marginalization_info->create<ResidualBlockInfo>(f_td, loss_function,
                                                                                         vector<double *>{para_Pose[imu_i], para_Pose[imu_j], para_Ex_Pose[0], para_Feature[feature_index], para_Td[0]},
                                                                                         vector<int>{0, 3});
                         marginalization_info->addResidualBlockInfo(residual_block_info);
@@ -960,18 +1084,18 @@ void Estimator::optimizationwithLine()
                         Vector3d pts_j_right = it_per_frame.pointRight;
                         if(imu_i != imu_j)
                         {
-                            ProjectionTwoFrameTwoCamFactor *f = new ProjectionTwoFrameTwoCamFactor(pts_i, pts_j_right, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocityRight,
+                            ProjectionTwoFrameTwoCamFactor *f = marginalization_info->create<ProjectionTwoFrameTwoCamFactor>(pts_i, pts_j_right, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocityRight,
                                                                           it_per_id.feature_per_frame[0].cur_td, it_per_frame.cur_td);
-                            ResidualBlockInfo *residual_block_info = new ResidualBlockInfo(f, loss_function,
+                            ResidualBlockInfo *residual_block_info = marginalization_info->create<ResidualBlockInfo>(f, loss_function,
                                                                                            vector<double *>{para_Pose[imu_i], para_Pose[imu_j], para_Ex_Pose[0], para_Ex_Pose[1], para_Feature[feature_index], para_Td[0]},
                                                                                            vector<int>{0, 4});
                             marginalization_info->addResidualBlockInfo(residual_block_info);
                         }
                         else
                         {
-                            ProjectionOneFrameTwoCamFactor *f = new ProjectionOneFrameTwoCamFactor(pts_i, pts_j_right, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocityRight,
+                            ProjectionOneFrameTwoCamFactor *f = marginalization_info->create<ProjectionOneFrameTwoCamFactor>(pts_i, pts_j_right, it_per_id.feature_per_frame[0].velocity, it_per_frame.velocityRight,
                                                                           it_per_id.feature_per_frame[0].cur_td, it_per_frame.cur_td);
-                            ResidualBlockInfo *residual_block_info = new ResidualBlockInfo(f, loss_function,
+                            ResidualBlockInfo *residual_block_info = marginalization_info->create<ResidualBlockInfo>(f, loss_function,
                                                                                            vector<double *>{para_Ex_Pose[0], para_Ex_Pose[1], para_Feature[feature_index], para_Td[0]},
                                                                                            vector<int>{2});
                             marginalization_info->addResidualBlockInfo(residual_block_info);
@@ -987,7 +1111,7 @@ void Estimator::optimizationwithLine()
             for (auto &it_per_id : f_manager.linefeature)
             {
                 it_per_id.used_num = it_per_id.linefeature_per_frame.size();                // 已经被多少帧观测到
-                if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))  
+                if (!it_per_id.isSolvable())  
                     continue;
                 ++linefeature_index;            // 这个变量会记录feature在 para_Feature 里的位置， 将深度存入para_Feature时索引的记录也是用的这种方式
 
@@ -1002,20 +1126,30 @@ void Estimator::optimizationwithLine()
                     std::vector<int> drop_set;
                     if(imu_i == imu_j)
                     {
-//                        drop_set = vector<int>{0, 2};   // marg pose and feature
-                        continue;
+                        if (!it_per_frame.is_stereo)
+                            continue;
+                        drop_set = vector<int>{0, 2};   // marg pose and feature
                     }else
                     {
                         drop_set = vector<int>{2};      // marg feature
                     }
 
                     Vector4d obs = it_per_frame.lineobs;                            // 在第j帧图像上的观测
-                    lineProjectionFactor *f = new lineProjectionFactor(obs);        // 特征重投影误差
+                    lineProjectionFactor *f = marginalization_info->create<lineProjectionFactor>(obs);        // 特征重投影误差
 
-                    ResidualBlockInfo *residual_block_info = new ResidualBlockInfo(f, loss_function,
+                    ResidualBlockInfo *residual_block_info = marginalization_info->create<ResidualBlockInfo>(f, loss_function,
                                                                                    vector<double *>{para_Pose[imu_j], para_Ex_Pose[0], para_LineFeature[linefeature_index]},
                                                                                    drop_set);// vector<int>{0, 2} 表示要marg的参数下标，比如这里对应para_Pose[imu_i], para_Feature[feature_index]
                     marginalization_info->addResidualBlockInfo(residual_block_info);
+
+                    if(STEREO && it_per_frame.is_stereo)
+                    {
+                        lineProjectionFactor *f_r = marginalization_info->create<lineProjectionFactor>(it_per_frame.lineobs_R);  // 右目观测
+                        ResidualBlockInfo *residual_block_info_r = marginalization_info->create<ResidualBlockInfo>(f_r, loss_function,
+                                                                                       vector<double *>{para_Pose[imu_j], para_Ex_Pose[1], para_LineFeature[linefeature_index]},
+                                                                                       drop_set);
+                        marginalization_info->addResidualBlockInfo(residual_block_info_r);
+                    }
                 }
             }
         }
@@ -1053,7 +1187,7 @@ void Estimator::optimizationwithLine()
             std::count(std::begin(last_marginalization_parameter_blocks), std::end(last_marginalization_parameter_blocks), para_Pose[WINDOW_SIZE - 1]))
         {
 
-            MarginalizationInfo *marginalization_info = new MarginalizationInfo();
+            MarginalizationInfo *marginalization_info = new MarginalizationInfo(marginalizationArena());
             vector2double();
             if (last_marginalization_info && last_marginalization_info->valid)
             {
@@ -1065,8 +1199,8 @@ void Estimator::optimizationwithLine()
                         drop_set.push_back(i);
                 }
                 // construct new marginlization_factor
-                MarginalizationFactor *marginalization_factor = new MarginalizationFactor(last_marginalization_info);
-                ResidualBlockInfo *residual_block_info = new ResidualBlockInfo(marginalization_factor, NULL,
+                MarginalizationFactor *marginalization_factor = marginalization_info->create<MarginalizationFactor>(last_marginalization_info);
+                ResidualBlockInfo *residual_block_info = marginalization_info->create<ResidualBlockInfo>(marginalization_factor, nullptr,
                                                                                last_marginalization_parameter_blocks,
                                                                                drop_set);
 
@@ -1306,7 +1440,7 @@ void  Estimator::LineBAincamera()
     for (auto &it_per_id : f_manager.linefeature)
     {
         it_per_id.used_num = it_per_id.linefeature_per_frame.size();                // 已经被多少帧观测到
-        if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))  
+        if (!it_per_id.isSolvable())  
             continue;
 
         ++linefeature_index;            // 这个变量会记录feature在 para_Feature 里的位置， 将深度存入para_Feature时索引的记录也是用的这种方式
@@ -1349,6 +1483,7 @@ void  Estimator::LineBAincamera()
     options.linear_solver_type = ceres::DENSE_SCHUR;
     //options.trust_region_strategy_type = ceres::DOGLEG;
     options.max_num_iterations = NUM_ITERATIONS;
+    options.num_threads = NUM_SOLVER_THREADS;
     ceres::Solver::Summary summary;
     ceres::Solve (options, &problem, & summary);
 
@@ -1497,6 +1632,8 @@ void Estimator::processImage(const map<int, vector<pair<int, Eigen::Matrix<doubl
             featureTracker.removeOutliers(removeIndex);
             predictPtsInNextFrame();
         }
+        else
+            updatePredictLandmarks(removeIndex);
             
         ROS_DEBUG("solver costs: %fms", t_solve.toc());
 
@@ -2094,7 +2231,7 @@ void Estimator::optimization()
     ceres::Solver::Options options;
 
     options.linear_solver_type = ceres::DENSE_SCHUR;
-    //options.num_threads = 2;
+    options.num_threads = NUM_SOLVER_THREADS;
     options.trust_region_strategy_type = ceres::DOGLEG;
     options.max_num_iterations = NUM_ITERATIONS;
     //options.use_explicit_schur_complement = true;
@@ -2477,6 +2614,170 @@ void Estimator::predictPtsInNextFrame()
     //printf("estimator output %d predict pts\n",(int)predictPts.size());
 }
 
+/**
+ * 多线程模式下后端不能直接改前端的状态，只把当前帧看到的路标点世界坐标和外点id留给前端，
+ * 由前端线程在跟踪前用predictPtsWithIMU读取
+ */
+void Estimator::updatePredictLandmarks(const set<int> &removeIndex)
+{
+    map<int, Eigen::Vector3d> landmarks;
+    for (auto &it_per_id : f_manager.feature)
+    {
+        if(it_per_id.estimated_depth > 0)
+        {
+            int firstIndex = it_per_id.start_frame;
+            int lastIndex = it_per_id.start_frame + it_per_id.feature_per_frame.size() - 1;
+            if((int)it_per_id.feature_per_frame.size() >= 2 && lastIndex == frame_count)
+            {
+                double depth = it_per_id.estimated_depth;
+                Vector3d pts_j = ric[0] * (depth * it_per_id.feature_per_frame[0].point) + tic[0];
+                landmarks[it_per_id.feature_id] = Rs[firstIndex] * pts_j + Ps[firstIndex];
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mPredict);
+    predictLandmarks.swap(landmarks);
+    predictRemoveIds.insert(removeIndex.begin(), removeIndex.end());
+    predictRic = ric[0];
+    predictTic = tic[0];
+    predictNonLinear = solver_flag == NON_LINEAR;
+}
+
+/**
+ * 当前帧看到的已三角化线特征：用当前帧的观测端点在普吕克直线上截出线段，保存端点的世界坐标给前端做匹配预测
+ */
+void Estimator::updatePredictLines()
+{
+    map<int, pair<Eigen::Vector3d, Eigen::Vector3d>> lines;
+    for (auto &it_per_id : f_manager.linefeature)
+    {
+        int lastIndex = it_per_id.start_frame + it_per_id.linefeature_per_frame.size() - 1;
+        if (!it_per_id.is_triangulation || lastIndex != frame_count)
+            continue;
+
+        int imu_i = it_per_id.start_frame;
+        Matrix3d Rwc_i = Rs[imu_i] * ric[0];
+        Vector3d twc_i = Rs[imu_i] * tic[0] + Ps[imu_i];
+        Matrix3d Rwc_j = Rs[frame_count] * ric[0];
+        Vector3d twc_j = Rs[frame_count] * tic[0] + Ps[frame_count];
+        Vector6d line_w = plk_to_pose(it_per_id.line_plucker, Rwc_i, twc_i);
+        Vector6d line_j = plk_from_pose(line_w, Rwc_j, twc_j);
+
+        Vector3d nc = line_j.head(3), vc = line_j.tail(3);
+        Matrix4d Lc;
+        Lc << skew_symmetric(nc), vc, -vc.transpose(), 0;
+
+        // 与pubLinesCloud相同：过观测端点、垂直于观测线的平面与直线求交
+        Vector4d obs = it_per_id.linefeature_per_frame.back().lineobs;
+        Vector3d p11 = Vector3d(obs(0), obs(1), 1.0);
+        Vector3d p21 = Vector3d(obs(2), obs(3), 1.0);
+        Vector2d ln = (p11.cross(p21)).head(2);
+        if (ln.norm() < 1e-9)
+            continue;
+        ln = ln / ln.norm();
+        Vector3d p12 = Vector3d(p11(0) + ln(0), p11(1) + ln(1), 1.0);
+        Vector3d p22 = Vector3d(p21(0) + ln(0), p21(1) + ln(1), 1.0);
+        Vector3d cam = Vector3d(0, 0, 0);
+        Vector4d e1 = Lc * pi_from_ppp(cam, p11, p12);
+        Vector4d e2 = Lc * pi_from_ppp(cam, p21, p22);
+        if (fabs(e1(3)) < 1e-9 || fabs(e2(3)) < 1e-9)
+            continue;
+        Vector3d pts_1 = e1.head(3) / e1(3), pts_2 = e2.head(3) / e2(3);
+        if (pts_1.z() <= 0 || pts_2.z() <= 0)
+            continue;
+        lines[it_per_id.feature_id] = make_pair(Vector3d(Rwc_j * pts_1 + twc_j), Vector3d(Rwc_j * pts_2 + twc_j));
+    }
+
+    std::lock_guard<std::mutex> lock(mPredict);
+    predictLineLandmarks.swap(lines);
+    predictRic = ric[0];
+    predictTic = tic[0];
+    predictNonLinear = solver_flag == NON_LINEAR;
+}
+
+/**
+ * 前端线程中调用：线特征端点用最新的IMU递推位姿投影到新图像上，作为门限匹配的中心
+ */
+void Estimator::predictLinesWithIMU()
+{
+    map<int, pair<Eigen::Vector3d, Eigen::Vector3d>> lines;
+    Eigen::Matrix3d ric0;
+    Eigen::Vector3d tic0;
+    bool nonLinear;
+    {
+        std::lock_guard<std::mutex> lock(mPredict);
+        lines = predictLineLandmarks;
+        ric0 = predictRic;
+        tic0 = predictTic;
+        nonLinear = predictNonLinear;
+    }
+    if (!USE_IMU || !nonLinear || lines.empty())
+        return;
+
+    Eigen::Matrix3d R;
+    Eigen::Vector3d P;
+    {
+        std::lock_guard<std::mutex> lock(mPropagate);
+        R = latest_Q.toRotationMatrix();
+        P = latest_P;
+    }
+
+    map<int, pair<Eigen::Vector3d, Eigen::Vector3d>> predictLines;
+    for (auto &it : lines)
+    {
+        Vector3d pts_1 = ric0.transpose() * (R.transpose() * (it.second.first - P) - tic0);
+        Vector3d pts_2 = ric0.transpose() * (R.transpose() * (it.second.second - P) - tic0);
+        if (pts_1.z() > 0 && pts_2.z() > 0)
+            predictLines[it.first] = make_pair(pts_1, pts_2);
+    }
+    linefeatureTracker.setPrediction(predictLines);
+}
+
+/**
+ * 前端线程中调用：用fastPredictIMU递推到最新IMU时刻的位姿，把后端给的路标点投影到新图像上，
+ * 作为光流的初值(OPTFLOW_USE_INITIAL_FLOW)
+ */
+void Estimator::predictPtsWithIMU()
+{
+    map<int, Eigen::Vector3d> landmarks;
+    set<int> removeIds;
+    Eigen::Matrix3d ric0;
+    Eigen::Vector3d tic0;
+    bool nonLinear;
+    {
+        // 路标点保留到后端下次更新，后端跟不上时后续帧仍可用最新的IMU位姿做预测
+        std::lock_guard<std::mutex> lock(mPredict);
+        landmarks = predictLandmarks;
+        removeIds.swap(predictRemoveIds);
+        ric0 = predictRic;
+        tic0 = predictTic;
+        nonLinear = predictNonLinear;
+    }
+    if (!removeIds.empty())
+        featureTracker.removeOutliers(removeIds);
+    if (!USE_IMU || !nonLinear || landmarks.empty())
+        return;
+
+    Eigen::Matrix3d R;
+    Eigen::Vector3d P;
+    {
+        std::lock_guard<std::mutex> lock(mPropagate);
+        R = latest_Q.toRotationMatrix();
+        P = latest_P;
+    }
+
+    map<int, Eigen::Vector3d> predictPts;
+    for (auto &it : landmarks)
+    {
+        Vector3d pts_local = R.transpose() * (it.second - P);
+        Vector3d pts_cam = ric0.transpose() * (pts_local - tic0);
+        if (pts_cam.z() > 0)
+            predictPts[it.first] = pts_cam;
+    }
+    featureTracker.setPrediction(predictPts);
+}
+
 double Estimator::reprojectionError(Matrix3d &Ri, Vector3d &Pi, Matrix3d &rici, Vector3d &tici,
                                  Matrix3d &Rj, Vector3d &Pj, Matrix3d &ricj, Vector3d &ticj, 
                                  double depth, Vector3d &uvi, Vector3d &uvj)
@@ -2564,6 +2865,7 @@ void Estimator::fastPredictIMU(double t, Eigen::Vector3d linear_acceleration, Ei
 
 void Estimator::updateLatestStates()
 {
+    std::lock_guard<std::mutex> lock(mPropagate);
     latest_time = Headers[frame_count] + td;
     latest_P = Ps[frame_count];
     latest_Q = Rs[frame_count];
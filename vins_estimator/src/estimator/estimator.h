@@ -11,6 +11,8 @@
  
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <std_msgs/Header.h>
 #include <std_msgs/Float32.h>
 #include <ceres/ceres.h>
@@ -22,6 +24,7 @@
 
 #include "parameters.h"
 #include "feature_manager.h"
+#include "feature_frame.h"
 #include "../utility/utility.h"
 #include "../utility/tic_toc.h"
 #include "../initial/solve_5pts.h"
@@ -38,6 +41,8 @@
 
 #include "../factor/line_parameterization.h"
 #include "../factor/line_projection_factor.h"
+#include "sliding_window_solver.h"
+#include "window_problem.h"
 
 #include "../featureTracker/feature_tracker.h"
 #include "../featureTracker/linefeature_tracker.h"
@@ -58,9 +63,7 @@ class Estimator
     void processIMU(double t, double dt, const Vector3d &linear_acceleration, const Vector3d &angular_velocity);
     void processImage(const map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> &image, const double header);
 
-    void processImage(const map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> &image, 
-                      const map<int, vector<pair<int, Vector4d>>> &lines, 
-                      const double header);
+    void processImage(const FeatureFrame &frame, const double header);
     void optimizationwithLine(); 
     void onlyLineOpt();
     void LineBA();
@@ -96,6 +99,10 @@ class Estimator
     void slideWindowNew();
     void slideWindowOld();
     void optimization();
+    template <typename Problem>
+    void addWindowFactors(Problem &problem);
+    void updateWindowProblem();
+    FrameArena *marginalizationArena();
     void vector2double();
     void double2vector();
     void double2vector2();
@@ -105,6 +112,11 @@ class Estimator
     void getPoseInWorldFrame(Eigen::Matrix4d &T);
     void getPoseInWorldFrame(int index, Eigen::Matrix4d &T);
     void predictPtsInNextFrame();
+    void updatePredictLandmarks(const set<int> &removeIndex);
+    void predictPtsWithIMU();
+    void updatePredictLines();
+    void predictLinesWithIMU();
+    bool isKeyframeCandidate(const FeatureFrame &frame);
     void outliersRejection(set<int> &removeIndex);
     double reprojectionError(Matrix3d &Ri, Vector3d &Pi, Matrix3d &rici, Vector3d &tici,
                                      Matrix3d &Rj, Vector3d &Pj, Matrix3d &ricj, Vector3d &ticj, 
@@ -129,12 +141,20 @@ class Estimator
 
     std::mutex mProcess;
     std::mutex mBuf;
+    std::condition_variable conBuf;  // 有新的特征帧或IMU数据时唤醒processThread
+    std::mutex mPropagate;           // 保护latest_*，IMU回调、后端和前端都会访问
+    std::mutex mPredict;
     queue<pair<double, Eigen::Vector3d>> accBuf;
     queue<pair<double, Eigen::Vector3d>> gyrBuf;
-    queue<pair<double, map<int, vector<pair<int, Eigen::Matrix<double, 8, 1> > > > > > featureBuf;
+    queue<FeatureFramePtr> featureBuf;  // 点线特征帧，只传递指针
 
-    // 线特征相关
-    queue<pair<double, map<int, vector<pair<int, Eigen::Matrix<double, 4, 1>> > > > > linefeatureBuf;
+    // 多线程模式下的帧调度：featureBuf满时跳过非关键帧候选
+    FeatureFramePtr lastQueuedFrame;     // 只在前端线程里读写
+    std::atomic<bool> resetQueuedFrame;  // clearState置位，前端下一帧清掉lastQueuedFrame
+    std::atomic<int> frameSkipCnt;       // 被跳过的帧数
+    std::atomic<int> frameDropCnt;       // 队列满时被新候选帧替换掉的已入队帧数
+    std::atomic<int> frameQueueDepth;    // 当前featureBuf中的帧数
+    std::atomic<int> frameQueueMaxDepth; // featureBuf达到过的最大帧数
 
 
     // 计数计时
@@ -152,6 +172,7 @@ class Estimator
 
     FeatureTracker featureTracker;
     LineFeatureTracker linefeatureTracker; 
+    ThreadPool line_track_pool;  // 线特征跟踪与点特征跟踪并行
 
     SolverFlag solver_flag;
     MarginalizationFlag  marginalization_flag;
@@ -212,6 +233,11 @@ class Estimator
     MarginalizationInfo *last_marginalization_info;
     vector<double *> last_marginalization_parameter_blocks;
 
+    SlidingWindowSolver window_solver;   // USE_SCHUR_SOLVER时代替ceres::Solve
+    WindowProblem window_problem;        // PERSISTENT_PROBLEM时跨帧保留的problem
+    FrameArena problem_arena;            // optimizationwithLine里局部problem的因子
+    FrameArena marginalization_arena[2]; // 边缘化的因子、雅可比和参数备份
+
     map<double, ImageFrame> all_image_frame;
     IntegrationBase *tmp_pre_integration;
 
@@ -222,6 +248,14 @@ class Estimator
     Eigen::Vector3d latest_P, latest_V, latest_Ba, latest_Bg, latest_acc_0, latest_gyr_0;
     Eigen::Quaterniond latest_Q;
 
+    // 多线程模式下后端交给前端的预测数据：当前帧看到的路标点世界坐标和要剔除的外点
+    map<int, Eigen::Vector3d> predictLandmarks;
+    set<int> predictRemoveIds;
+    map<int, pair<Eigen::Vector3d, Eigen::Vector3d>> predictLineLandmarks;  // 线特征端点的世界坐标
+    Eigen::Matrix3d predictRic;  // 和上面的点、线路标一起更新的外参快照，前端只用快照，不读ric/tic
+    Eigen::Vector3d predictTic;
+    bool predictNonLinear;       // 快照时solver_flag == NON_LINEAR
+
     bool initFirstPoseFlag;
     bool initThreadFlag;
 };
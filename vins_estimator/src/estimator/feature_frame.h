@@ -0,0 +1,150 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <eigen3/Eigen/Dense>
+
+using namespace std;
+
+/**
+ * 一帧图像的点、线特征，按数组结构(SoA)连续存放，由前端填充后以指针形式经featureBuf交给后端。
+ * 点按(id, 相机号)升序排列，同一个id的左目观测紧跟着右目观测；线按(id, 相机号)升序排列。
+ */
+class FeatureFrame
+{
+  public:
+    FeatureFrame() : t(0) {}
+
+    void clear()
+    {
+        ids.clear(); cam_ids.clear();
+        x.clear(); y.clear(); u.clear(); v.clear();
+        vx.clear(); vy.clear(); depth.clear();
+        line_ids.clear(); line_cam_ids.clear();
+        line_sx.clear(); line_sy.clear(); line_ex.clear(); line_ey.clear();
+    }
+
+    void reservePoints(size_t n)
+    {
+        ids.reserve(n); cam_ids.reserve(n);
+        x.reserve(n); y.reserve(n); u.reserve(n); v.reserve(n);
+        vx.reserve(n); vy.reserve(n); depth.reserve(n);
+    }
+
+    void reserveLines(size_t n)
+    {
+        line_ids.reserve(n); line_cam_ids.reserve(n);
+        line_sx.reserve(n); line_sy.reserve(n); line_ex.reserve(n); line_ey.reserve(n);
+    }
+
+    // p: x, y, z(=1), p_u, p_v, velocity_x, velocity_y, depth
+    void addPoint(int id, int cam_id, const Eigen::Matrix<double, 8, 1> &p)
+    {
+        ids.push_back(id);
+        cam_ids.push_back(cam_id);
+        x.push_back(p(0));
+        y.push_back(p(1));
+        u.push_back(p(3));
+        v.push_back(p(4));
+        vx.push_back(p(5));
+        vy.push_back(p(6));
+        depth.push_back(p(7));
+    }
+
+    // l: 归一化平面上的起点、终点 x1, y1, x2, y2
+    void addLine(int id, int cam_id, const Eigen::Vector4d &l)
+    {
+        line_ids.push_back(id);
+        line_cam_ids.push_back(cam_id);
+        line_sx.push_back(l(0));
+        line_sy.push_back(l(1));
+        line_ex.push_back(l(2));
+        line_ey.push_back(l(3));
+    }
+
+    size_t pointSize() const { return ids.size(); }
+    size_t lineSize() const { return line_ids.size(); }
+
+    Eigen::Matrix<double, 8, 1> point(size_t i) const
+    {
+        Eigen::Matrix<double, 8, 1> p;
+        p << x[i], y[i], 1, u[i], v[i], vx[i], vy[i], depth[i];
+        return p;
+    }
+
+    Eigen::Vector4d line(size_t i) const
+    {
+        return Eigen::Vector4d(line_sx[i], line_sy[i], line_ex[i], line_ey[i]);
+    }
+
+    // 前端按跟踪顺序添加特征，最后统一按(id, 相机号)排序
+    void sortById()
+    {
+        vector<size_t> order = sortedOrder(ids, cam_ids);
+        permute(order, ids); permute(order, cam_ids);
+        permute(order, x); permute(order, y); permute(order, u); permute(order, v);
+        permute(order, vx); permute(order, vy); permute(order, depth);
+
+        order = sortedOrder(line_ids, line_cam_ids);
+        permute(order, line_ids); permute(order, line_cam_ids);
+        permute(order, line_sx); permute(order, line_sy); permute(order, line_ex); permute(order, line_ey);
+    }
+
+    // 初始化阶段的ImageFrame仍然使用map格式
+    map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> toPointMap() const
+    {
+        map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> points;
+        for (size_t i = 0; i < ids.size(); i++)
+            points[ids[i]].emplace_back(cam_ids[i], point(i));
+        return points;
+    }
+
+    double t;
+
+    // 点特征
+    vector<int> ids;
+    vector<int> cam_ids;
+    vector<double> x, y;        // 归一化平面坐标
+    vector<double> u, v;        // 像素坐标
+    vector<double> vx, vy;      // 归一化平面上的速度
+    vector<double> depth;
+
+    // 线特征
+    vector<int> line_ids;
+    vector<int> line_cam_ids;
+    vector<double> line_sx, line_sy, line_ex, line_ey;
+
+  private:
+    static vector<size_t> sortedOrder(const vector<int> &id, const vector<int> &cam)
+    {
+        vector<size_t> order(id.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                  {
+            return id[a] < id[b] || (id[a] == id[b] && cam[a] < cam[b]);
+                  });
+        return order;
+    }
+
+    template <typename T>
+    static void permute(const vector<size_t> &order, vector<T> &data)
+    {
+        vector<T> sorted(data.size());
+        for (size_t i = 0; i < order.size(); i++)
+            sorted[i] = data[order[i]];
+        data.swap(sorted);
+    }
+};
+typedef std::shared_ptr<FeatureFrame> FeatureFramePtr;
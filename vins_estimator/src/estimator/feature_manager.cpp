@@ -13,6 +13,18 @@ int lineFeaturePerId::endFrame()
 {
     return start_frame + linefeature_per_frame.size() - 1;
 }
+
+/**
+ * 线特征是否加入滑窗优化：已经三角化，start_frame < WINDOW_SIZE - 2，且观测帧数够了。
+ * line_plucker在起始帧坐标系下，次新帧还可能被丢掉，所以滑窗满时start_frame = WINDOW_SIZE的新线
+ * 要滑动三次(10->9->8->7)才进入优化。起始帧左右目都看到时单帧就能约束住直线，不用等LINE_MIN_OBS帧。
+ * 调用前要更新used_num
+ */
+bool lineFeaturePerId::isSolvable()
+{
+    int min_obs = linefeature_per_frame.front().is_stereo ? 1 : LINE_MIN_OBS;
+    return used_num >= min_obs && start_frame < WINDOW_SIZE - 2 && is_triangulation;
+}
 // end
 
 int FeaturePerId::endFrame()
@@ -77,18 +89,14 @@ bool FeatureManager::addFeatureCheckParallax(int frame_count, const map<int, vec
         }
 
         int feature_id = id_pts.first;
-        auto it = find_if(feature.begin(), feature.end(), [feature_id](const FeaturePerId &it)
-                          {
-            return it.feature_id == feature_id;
-                          });
+        FeaturePerId *it = feature.find(feature_id);
 
-        if (it == feature.end())
+        if (it == nullptr)
         {
-            feature.push_back(FeaturePerId(feature_id, frame_count));
-            feature.back().feature_per_frame.push_back(f_per_fra);
+            feature.insert(FeaturePerId(feature_id, frame_count)).feature_per_frame.push_back(f_per_fra);
             new_feature_num++;
         }
-        else if (it->feature_id == feature_id)
+        else
         {
             it->feature_per_frame.push_back(f_per_fra);
             last_track_num++;
@@ -126,13 +134,10 @@ bool FeatureManager::addFeatureCheckParallax(int frame_count, const map<int, vec
 }
 
 // -- 点线特征------------------
-bool FeatureManager::addFeatureCheckParallax(int frame_count, 
-                                             const map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> &image, 
-                                             const map<int, vector<pair<int, Vector4d>>> &lines, 
-                                             double td)
+bool FeatureManager::addFeatureCheckParallax(int frame_count, const FeatureFrame &frame, double td)
 {
-    ROS_DEBUG("input point feature: %d", (int)image.size());
-    ROS_DEBUG("input line feature: %d", (int)lines.size());
+    ROS_DEBUG("input point feature: %d", (int)frame.pointSize());
+    ROS_DEBUG("input line feature: %d", (int)frame.lineSize());
     ROS_DEBUG("num of feature: %d", getFeatureCount());  // 已有的特征数目
     double parallax_sum = 0;
     int parallax_num = 0;
@@ -141,30 +146,28 @@ bool FeatureManager::addFeatureCheckParallax(int frame_count,
     last_average_parallax = 0;
     new_feature_num = 0;
     long_track_num = 0;
-    for (auto &id_pts : image)
+    // 点按id排序，同一id的左目观测后面紧跟右目观测
+    for (size_t i = 0; i < frame.pointSize(); i++)
     {
-        FeaturePerFrame f_per_fra(id_pts.second[0].second, td);
-        assert(id_pts.second[0].first == 0); // 该特征点在左图上，如果它的条件返回错误，则终止程序执行
+        assert(frame.cam_ids[i] == 0); // 该特征点在左图上，如果它的条件返回错误，则终止程序执行
+        FeaturePerFrame f_per_fra(frame.point(i), td);
  
-        if(id_pts.second.size() == 2) //存在右图，基于右图特征点，更新FeaturePerFrame信息
+        int feature_id = frame.ids[i];
+        if(i + 1 < frame.pointSize() && frame.ids[i + 1] == feature_id) //存在右图，基于右图特征点，更新FeaturePerFrame信息
         {
-            f_per_fra.rightObservation(id_pts.second[1].second);
-            assert(id_pts.second[1].first == 1);
+            i++;
+            assert(frame.cam_ids[i] == 1);
+            f_per_fra.rightObservation(frame.point(i));
         }
 
-        int feature_id = id_pts.first;
-        auto it = find_if(feature.begin(), feature.end(), [feature_id](const FeaturePerId &it)
-                          {
-            return it.feature_id == feature_id;
-                          });
+        FeaturePerId *it = feature.find(feature_id);
 
-        if (it == feature.end())
+        if (it == nullptr)
         {
-            feature.push_back(FeaturePerId(feature_id, frame_count));
-            feature.back().feature_per_frame.push_back(f_per_fra);
+            feature.insert(FeaturePerId(feature_id, frame_count)).feature_per_frame.push_back(f_per_fra);
             new_feature_num++;
         }
-        else if (it->feature_id == feature_id)
+        else
         {
             it->feature_per_frame.push_back(f_per_fra);
             last_track_num++;
@@ -174,22 +177,22 @@ bool FeatureManager::addFeatureCheckParallax(int frame_count,
 
     }
 
-    for (auto &id_line : lines)   //遍历当前帧上的特征
+    for (size_t i = 0; i < frame.lineSize(); i++)   //遍历当前帧上的特征
     {
-        lineFeaturePerFrame f_per_fra(id_line.second[0].second);  // 观测
+        if (frame.line_cam_ids[i] != 0)
+            continue;
+        lineFeaturePerFrame f_per_fra(frame.line(i));  // 观测
+        if (i + 1 < frame.lineSize() && frame.line_ids[i + 1] == frame.line_ids[i])   // 按(id, 相机号)排序，右目观测紧跟在左目后面
+            f_per_fra.rightObservation(frame.line(i + 1));
 
-        int feature_id = id_line.first;
-        auto it = find_if(linefeature.begin(), linefeature.end(), [feature_id](const lineFeaturePerId &it)
-        {
-            return it.feature_id == feature_id;    // 在feature里找id号为feature_id的特征
-        });
+        int feature_id = frame.line_ids[i];
+        lineFeaturePerId *it = linefeature.find(feature_id);   // 在linefeature里找id号为feature_id的特征
 
-        if (it == linefeature.end())  // 如果之前没存这个特征，说明是新的
+        if (it == nullptr)  // 如果之前没存这个特征，说明是新的
         {
-            linefeature.push_back(lineFeaturePerId(feature_id, frame_count));
-            linefeature.back().linefeature_per_frame.push_back(f_per_fra);
+            linefeature.insert(lineFeaturePerId(feature_id, frame_count)).linefeature_per_frame.push_back(f_per_fra);
         }
-        else if (it->feature_id == feature_id)
+        else
         {
             it->linefeature_per_frame.push_back(f_per_fra);
             it->all_obs_cnt++;
@@ -223,97 +226,6 @@ bool FeatureManager::addFeatureCheckParallax(int frame_count,
     }
 }
 
-// bool FeatureManager::addFeatureCheckParallax(int frame_count, const map<int, vector<pair<int, Eigen::Matrix<double, 7, 1>>>> &image, const map<int, vector<pair<int, Vector8d>>> &lines, double td)
-// {
-//     ROS_DEBUG("input point feature: %d", (int)image.size());
-//     ROS_DEBUG("input line feature: %d", (int)lines.size());
-//     ROS_DEBUG("num of feature: %d", getFeatureCount());  // 已有的特征数目
-//     double parallax_sum = 0;
-//     int parallax_num = 0;
-//     last_track_num = 0;
-
-//     last_average_parallax = 0;
-//     new_feature_num = 0;
-//     long_track_num = 0;
-//     for (auto &id_pts : image)
-//     {
-//         FeaturePerFrame f_per_fra(id_pts.second[0].second, td);
-//         assert(id_pts.second[0].first == 0);
-//         if(id_pts.second.size() == 2)
-//         {
-//             f_per_fra.rightObservation(id_pts.second[1].second);
-//             assert(id_pts.second[1].first == 1);
-//         }
-
-//         int feature_id = id_pts.first;
-//         auto it = find_if(feature.begin(), feature.end(), [feature_id](const FeaturePerId &it)
-//                           {
-//             return it.feature_id == feature_id;
-//                           });
-
-//         if (it == feature.end())
-//         {
-//             feature.push_back(FeaturePerId(feature_id, frame_count));
-//             feature.back().feature_per_frame.push_back(f_per_fra);
-//             new_feature_num++;
-//         }
-//         else if (it->feature_id == feature_id)
-//         {
-//             it->feature_per_frame.push_back(f_per_fra);
-//             last_track_num++;
-//             if( it-> feature_per_frame.size() >= 4)
-//                 long_track_num++;
-//         }
-//     }
-
-//     for (auto &id_line : lines)   //遍历当前帧上的特征
-//     {
-//         lineFeaturePerFrame f_per_fra(id_line.second[0].second);  // 观测
-
-//         int feature_id = id_line.first;
-//         //cout << "line id: "<< feature_id << "\n";
-//         auto it = find_if(linefeature.begin(), linefeature.end(), [feature_id](const lineFeaturePerId &it)
-//         {
-//             return it.feature_id == feature_id;    // 在feature里找id号为feature_id的特征
-//         });
-
-//         if (it == linefeature.end())  // 如果之前没存这个特征，说明是新的
-//         {
-//             linefeature.push_back(lineFeaturePerId(feature_id, frame_count));
-//             linefeature.back().linefeature_per_frame.push_back(f_per_fra);
-//         }
-//         else if (it->feature_id == feature_id)
-//         {
-//             it->linefeature_per_frame.push_back(f_per_fra);
-//             it->all_obs_cnt++;
-//         }
-//     }
-
-//     if (frame_count < 2 || last_track_num < 20 || long_track_num < 40 || new_feature_num > 0.5 * last_track_num)
-//         return true;
-
-//     for (auto &it_per_id : feature)
-//     {
-//         if (it_per_id.start_frame <= frame_count - 2 &&
-//             it_per_id.start_frame + int(it_per_id.feature_per_frame.size()) - 1 >= frame_count - 1)
-//         {
-//             parallax_sum += compensatedParallax2(it_per_id, frame_count);
-//             parallax_num++;
-//         }
-//     }
-
-//     if (parallax_num == 0)
-//     {
-//         return true;
-//     }
-//     else
-//     {
-//         ROS_DEBUG("parallax_sum: %lf, parallax_num: %d", parallax_sum, parallax_num);
-//         ROS_DEBUG("current parallax: %lf", parallax_sum / parallax_num * FOCAL_LENGTH);
-//         return parallax_sum / parallax_num >= MIN_PARALLAX;
-//     }
-// }
-
 // void FeatureManager::debugShow()
 // {
 //     ROS_DEBUG("debug show");
@@ -343,7 +255,7 @@ int FeatureManager::getLineFeatureCount()
 
         it.used_num = it.linefeature_per_frame.size();
 
-        if (it.used_num >= LINE_MIN_OBS && it.start_frame < WINDOW_SIZE - 2 && it.is_triangulation)
+        if (it.isSolvable())
         {
             cnt++;
         }
@@ -358,7 +270,7 @@ MatrixXd FeatureManager::getLineOrthVectorInCamera()
     for (auto &it_per_id : linefeature)
     {
         it_per_id.used_num = it_per_id.linefeature_per_frame.size();
-        if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))
+        if (!it_per_id.isSolvable())
             continue;
 
         lineorth_vec.row(++feature_index) = plk_to_orth(it_per_id.line_plucker);
@@ -372,7 +284,7 @@ void FeatureManager::setLineOrthInCamera(MatrixXd x)
     for (auto &it_per_id : linefeature)
     {
         it_per_id.used_num = it_per_id.linefeature_per_frame.size();
-        if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))
+        if (!it_per_id.isSolvable())
             continue;
 
         //std::cout<<"x:"<<x.rows() <<" "<<feature_index<<"\n";
@@ -397,7 +309,7 @@ MatrixXd FeatureManager::getLineOrthVector(Vector3d Ps[], Vector3d tic[], Matrix
     for (auto &it_per_id : linefeature)
     {
         it_per_id.used_num = it_per_id.linefeature_per_frame.size();
-        if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))
+        if (!it_per_id.isSolvable())
             continue;
 
         int imu_i = it_per_id.start_frame;
@@ -422,7 +334,7 @@ void FeatureManager::setLineOrth(MatrixXd x,Vector3d P[], Matrix3d R[], Vector3d
     for (auto &it_per_id : linefeature)
     {
         it_per_id.used_num = it_per_id.linefeature_per_frame.size();
-        if (!(it_per_id.used_num >= LINE_MIN_OBS && it_per_id.start_frame < WINDOW_SIZE - 2 && it_per_id.is_triangulation))
+        if (!it_per_id.isSolvable())
             continue;
 
         Vector4d line_orth_w = x.row(++feature_index);
@@ -639,22 +551,25 @@ void FeatureManager::triangulateLine(Vector3d Ps[], Vector3d tic[], Matrix3d ric
 
 /**
  *  @brief  stereo line triangulate
+ *  起始帧有右目观测的线，用左右目观测和左目反投影出的两个平面求交，结果在起始帧左目相机坐标系下。
+ *  左右目平面接近重合(线段和基线平行)时交线不稳定，留给多帧三角化
  */
-void FeatureManager::triangulateLine(double baseline)
+void FeatureManager::triangulateStereoLine(Vector3d tic[], Matrix3d ric[])
 {
-    for (auto &it_per_id : linefeature)        // 遍历每个特征，对新特征进行三角化
+    // 右目相机在左目相机坐标系下的位姿
+    Matrix3d R01 = ric[0].transpose() * ric[1];
+    Vector3d t01 = ric[0].transpose() * (tic[1] - tic[0]);
+
+    for (auto &it_per_id : linefeature)
     {
-        it_per_id.used_num = it_per_id.linefeature_per_frame.size();    // 已经有多少帧看到了这个特征
-        // TODO: 右目没看到
-        if (it_per_id.is_triangulation || it_per_id.used_num < 2)  // 已经三角化了 或者 少于两帧看到 或者 右目没有看到
+        if (it_per_id.is_triangulation)
+            continue;
+        const lineFeaturePerFrame &it_per_frame = it_per_id.linefeature_per_frame.front();
+        if (!it_per_frame.is_stereo)   // 起始帧右目没有看到
             continue;
 
-        int imu_i = it_per_id.start_frame;
-
-        Vector4d lineobs_l,lineobs_r;
-        lineFeaturePerFrame it_per_frame = it_per_id.linefeature_per_frame.front();
-        lineobs_l = it_per_frame.lineobs;
-        lineobs_r = it_per_frame.lineobs_R;
+        Vector4d lineobs_l = it_per_frame.lineobs;
+        Vector4d lineobs_r = it_per_frame.lineobs_R;
 
         // plane pi from ith left obs in ith left camera frame
         Vector3d p1( lineobs_l(0), lineobs_l(1), 1 );
@@ -662,121 +577,26 @@ void FeatureManager::triangulateLine(double baseline)
         Vector4d pii = pi_from_ppp(p1, p2,Vector3d( 0, 0, 0 ));
 
         // plane pi from ith right obs in ith left camera frame
-        Vector3d p3( lineobs_r(0) + baseline, lineobs_r(1), 1 );
-        Vector3d p4( lineobs_r(2) + baseline, lineobs_r(3), 1 );
-        Vector4d pij = pi_from_ppp(p3, p4,Vector3d(baseline, 0, 0));
+        Vector3d p3 = R01 * Vector3d( lineobs_r(0), lineobs_r(1), 1 ) + t01;
+        Vector3d p4 = R01 * Vector3d( lineobs_r(2), lineobs_r(3), 1 ) + t01;
+        Vector4d pij = pi_from_ppp(p3, p4, t01);
 
-        Vector6d plk = pipi_plk( pii, pij );
-        Vector3d n = plk.head(3);
-        Vector3d v = plk.tail(3);
-
-        //Vector3d cp = plucker_origin( n, v );
-        //if ( cp(2) < 0 )
-        {
-            //  cp = - cp;
-            //  continue;
-        }
-
-        //Vector6d line;
-        //line.head(3) = cp;
-        //line.tail(3) = v;
-        //it_per_id.line_plucker = line;
+        Vector3d ni = pii.head(3), nj = pij.head(3);
+        if (fabs(ni.normalized().dot(nj.normalized())) > 0.998)
+            continue;
 
-        // plk.normalize();
-        it_per_id.line_plucker = plk;  // plk in camera frame
+        it_per_id.line_plucker = pipi_plk( pii, pij );  // plk in camera frame
         it_per_id.is_triangulation = true;
-
-        //if(isnan(cp(0)))
-        {
-
-            //it_per_id.is_triangulation = false;
-
-            //std::cout <<"------------"<<std::endl;
-            //std::cout << line << "\n\n";
-            //std::cout << d <<"\n\n";
-            //std::cout << Rij <<std::endl;
-            //std::cout << tij <<"\n\n";
-            //std::cout <<"obsj: "<< obsj <<"\n\n";
-            //std::cout << "p3: " << p3 <<"\n\n";
-            //std::cout << "p4: " << p4 <<"\n\n";
-            //std::cout <<pi_from_ppp(p3, p4,tij)<<std::endl;
-            //std::cout << pij <<"\n\n";
-
-        }
     }
-    removeLineOutlier();
 }
 
-void FeatureManager::removeLineOutlier()
-{
-
-    for (auto it_per_id = linefeature.begin(), it_next = linefeature.begin();
-         it_per_id != linefeature.end(); it_per_id = it_next)
-    {
-        it_next++;
-        it_per_id->used_num = it_per_id->linefeature_per_frame.size();
-        if (it_per_id->is_triangulation || it_per_id->used_num < 2)  // 已经三角化了 或者 少于两帧看到 或者 右目没有看到
-            continue;
-
-        int imu_i = it_per_id->start_frame, imu_j = imu_i -1;
-
-        // 计算初始帧上线段对应的3d端点
-        Vector3d pc, nc, vc;
-        nc = it_per_id->line_plucker.head(3);
-        vc = it_per_id->line_plucker.tail(3);
-
-        Matrix4d Lc;
-        Lc << skew_symmetric(nc), vc, -vc.transpose(), 0;
-
-        Vector4d obs_startframe = it_per_id->linefeature_per_frame[0].lineobs;   // 第一次观测到这帧
-        Vector3d p11 = Vector3d(obs_startframe(0), obs_startframe(1), 1.0);
-        Vector3d p21 = Vector3d(obs_startframe(2), obs_startframe(3), 1.0);
-        Vector2d ln = ( p11.cross(p21) ).head(2);     // 直线的垂直方向
-        ln = ln / ln.norm();
-
-        Vector3d p12 = Vector3d(p11(0) + ln(0), p11(1) + ln(1), 1.0);  // 直线垂直方向上移动一个单位
-        Vector3d p22 = Vector3d(p21(0) + ln(0), p21(1) + ln(1), 1.0);
-        Vector3d cam = Vector3d( 0, 0, 0 );
-
-        Vector4d pi1 = pi_from_ppp(cam, p11, p12);
-        Vector4d pi2 = pi_from_ppp(cam, p21, p22);
-
-        Vector4d e1 = Lc * pi1;
-        Vector4d e2 = Lc * pi2;
-        e1 = e1/e1(3);
-        e2 = e2/e2(3);
-
-        if(e1(2) < 0 || e2(2) < 0)
-        {
-            linefeature.erase(it_per_id);
-            continue;
-        }
-
-        if((e1-e2).norm() > 10)
-        {
-            linefeature.erase(it_per_id);
-            continue;
-        }
-/*
-        Vector3d Q = plucker_origin(nc,vc);
-        if(Q.norm() > 5.0)
-        {
-            linefeature.erase(it_per_id);
-            continue;
-        }
-*/
-
-    }
-}
 void FeatureManager::removeLineOutlier(Vector3d Ps[], Vector3d tic[], Matrix3d ric[])
 {
 
-    for (auto it_per_id = linefeature.begin(), it_next = linefeature.begin();
-         it_per_id != linefeature.end(); it_per_id = it_next)
+    for (auto it_per_id = linefeature.begin(); it_per_id != linefeature.end(); ++it_per_id)
     {
-        it_next++;
         it_per_id->used_num = it_per_id->linefeature_per_frame.size();
-        if (!(it_per_id->used_num >= LINE_MIN_OBS && it_per_id->start_frame < WINDOW_SIZE - 2 && it_per_id->is_triangulation))
+        if (!it_per_id->isSolvable())
             continue;
 
         int imu_i = it_per_id->start_frame, imu_j = imu_i -1;
@@ -823,12 +643,12 @@ void FeatureManager::removeLineOutlier(Vector3d Ps[], Vector3d tic[], Matrix3d r
         //std::cout << "line endpoint: "<<e1 << "\n "<< e2<<"\n";
         if(e1(2) < 0 || e2(2) < 0)
         {
-            linefeature.erase(it_per_id);
+            it_per_id->is_outlier = true;
             continue;
         }
         if((e1-e2).norm() > 10)
         {
-            linefeature.erase(it_per_id);
+            it_per_id->is_outlier = true;
             continue;
         }
 
@@ -870,9 +690,10 @@ void FeatureManager::removeLineOutlier(Vector3d Ps[], Vector3d tic[], Matrix3d r
         if (allerr > 3.0 / 500.0)
         {
 //            std::cout<<"remove a large error\n";
-            linefeature.erase(it_per_id);
+            it_per_id->is_outlier = true;
         }
     }
+    linefeature.removeIf([](const lineFeaturePerId &l) { return l.is_outlier; });
 }
 
 
@@ -921,13 +742,7 @@ void FeatureManager::setDepth(const VectorXd &x)
 
 void FeatureManager::removeFailures()
 {
-    for (auto it = feature.begin(), it_next = feature.begin();
-         it != feature.end(); it = it_next)
-    {
-        it_next++;
-        if (it->solve_flag == 2)
-            feature.erase(it);
-    }
+    feature.removeIf([](const FeaturePerId &f) { return f.solve_flag == 2; });
 }
 
 void FeatureManager::clearDepth()
@@ -1213,28 +1028,13 @@ void FeatureManager::triangulate(int frameCnt, Vector3d Ps[], Matrix3d Rs[], Vec
 
 void FeatureManager::removeOutlier(set<int> &outlierIndex)
 {
-    std::set<int>::iterator itSet;
-    for (auto it = feature.begin(), it_next = feature.begin();
-         it != feature.end(); it = it_next)
-    {
-        it_next++;
-        int index = it->feature_id;
-        itSet = outlierIndex.find(index);
-        if(itSet != outlierIndex.end())
-        {
-            feature.erase(it);
-            //printf("remove outlier %d \n", index);
-        }
-    }
+    feature.removeIf([&outlierIndex](const FeaturePerId &f) { return outlierIndex.count(f.feature_id) > 0; });
 }
 
 void FeatureManager::removeBackShiftDepth(Eigen::Matrix3d marg_R, Eigen::Vector3d marg_P, Eigen::Matrix3d new_R, Eigen::Vector3d new_P)
 {
-    for (auto it = feature.begin(), it_next = feature.begin();
-         it != feature.end(); it = it_next)
+    for (auto it = feature.begin(); it != feature.end(); ++it)
     {
-        it_next++;
-
         if (it->start_frame != 0)
             it->start_frame--;
         else
@@ -1243,7 +1043,7 @@ void FeatureManager::removeBackShiftDepth(Eigen::Matrix3d marg_R, Eigen::Vector3
             it->feature_per_frame.erase(it->feature_per_frame.begin());
             if (it->feature_per_frame.size() < 2)
             {
-                feature.erase(it);
+                it->feature_per_frame.clear();   // 循环结束后统一删除
                 continue;
             }
             else
@@ -1268,11 +1068,8 @@ void FeatureManager::removeBackShiftDepth(Eigen::Matrix3d marg_R, Eigen::Vector3
     }
 
     //  线特征相关
-    for (auto it = linefeature.begin(), it_next = linefeature.begin();
-         it != linefeature.end(); it = it_next)
+    for (auto it = linefeature.begin(); it != linefeature.end(); ++it)
     {
-        it_next++;
-
         if (it->start_frame != 0)    // 如果特征不是在这帧上初始化的，那就不用管，只要管id--
         {
             it->start_frame--;
@@ -1282,7 +1079,7 @@ void FeatureManager::removeBackShiftDepth(Eigen::Matrix3d marg_R, Eigen::Vector3
             it->linefeature_per_frame.erase(it->linefeature_per_frame.begin());  // 移除观测
             if (it->linefeature_per_frame.size() < 2)                     // 如果观测到这个帧的图像少于两帧，那这个特征不要了
             {
-                linefeature.erase(it);
+                it->linefeature_per_frame.clear();
                 continue;
             }
             else  // 如果还有很多帧看到它，而我们又把这个特征的初始化帧给marg掉了，那就得把这个特征转挂到下一帧上去, 这里 marg_R, new_R 都是相应时刻的相机坐标系到世界坐标系的变换
@@ -1330,32 +1127,25 @@ void FeatureManager::removeBackShiftDepth(Eigen::Matrix3d marg_R, Eigen::Vector3
 */
         }
     }
+    removeUnobserved();
 }
 
 void FeatureManager::removeBack()
 {
-    for (auto it = feature.begin(), it_next = feature.begin();
-         it != feature.end(); it = it_next)
+    for (auto it = feature.begin(); it != feature.end(); ++it)
     {
-        it_next++;
-
         if (it->start_frame != 0)
             it->start_frame--;
         else
         {
             it->feature_per_frame.erase(it->feature_per_frame.begin());
-            if (it->feature_per_frame.size() == 0)
-                feature.erase(it);
         }
     }
 
     // 线特征相关
     std::cout << "remove back" << std::endl;
-    for (auto it = linefeature.begin(), it_next = linefeature.begin();
-         it != linefeature.end(); it = it_next)
+    for (auto it = linefeature.begin(); it != linefeature.end(); ++it)
     {
-        it_next++;
-
         // 如果这个特征不是在窗口里最老关键帧上观测到的，由于窗口里移除掉了一个帧，所有其他特征对应的初始化帧id都要减1左移
         // 例如： 窗口里有 0,1,2,3,4 一共5个关键帧，特征f2在第2帧上三角化的， 移除掉第0帧以后， 第2帧在窗口里的id就左移变成了第1帧，这是很f2的start_frame对应减1
         if (it->start_frame != 0)
@@ -1363,18 +1153,15 @@ void FeatureManager::removeBack()
         else
         {
             it->linefeature_per_frame.erase(it->linefeature_per_frame.begin());  // 删掉特征ft在这个图像帧上的观测量
-            if (it->linefeature_per_frame.size() == 0)                       // 如果没有其他图像帧能看到这个特征ft了，那就直接删掉它
-                linefeature.erase(it);
         }
     }
+    removeUnobserved();
 }
 
 void FeatureManager::removeFront(int frame_count)
 {
-    for (auto it = feature.begin(), it_next = feature.begin(); it != feature.end(); it = it_next)
+    for (auto it = feature.begin(); it != feature.end(); ++it)
     {
-        it_next++;
-
         if (it->start_frame == frame_count)
         {
             it->start_frame--;
@@ -1385,17 +1172,13 @@ void FeatureManager::removeFront(int frame_count)
             if (it->endFrame() < frame_count - 1)
                 continue;
             it->feature_per_frame.erase(it->feature_per_frame.begin() + j);
-            if (it->feature_per_frame.size() == 0)
-                feature.erase(it);
         }
     }
 
 
     // 线特征相关
-    for (auto it = linefeature.begin(), it_next = linefeature.begin(); it != linefeature.end(); it = it_next)
+    for (auto it = linefeature.begin(); it != linefeature.end(); ++it)
     {
-        it_next++;
-
         if (it->start_frame == frame_count)  // 由于要删去的是第frame_count-1帧，最新这一帧frame_count的id就变成了i-1
         {
             it->start_frame--;
@@ -1406,10 +1189,16 @@ void FeatureManager::removeFront(int frame_count)
             if (it->endFrame() < frame_count - 1)
                 continue;
             it->linefeature_per_frame.erase(it->linefeature_per_frame.begin() + j);   // 删掉特征ft在这个图像帧上的观测量
-            if (it->linefeature_per_frame.size() == 0)                            // 如果没有其他图像帧能看到这个特征ft了，那就直接删掉它
-                linefeature.erase(it);
         }
     }   
+    removeUnobserved();
+}
+
+// 滑窗移动后没有观测的点、线特征
+void FeatureManager::removeUnobserved()
+{
+    feature.removeIf([](const FeaturePerId &f) { return f.feature_per_frame.empty(); });
+    linefeature.removeIf([](const lineFeaturePerId &l) { return l.linefeature_per_frame.empty(); });
 }
 
 double FeatureManager::compensatedParallax2(const FeaturePerId &it_per_id, int frame_count)
@@ -23,6 +23,8 @@ using namespace Eigen;
 #include <ros/assert.h>
 
 #include "parameters.h"
+#include "feature_frame.h"
+#include "landmark_store.h"
 #include "../utility/tic_toc.h"
 #include "../utility/line_geometry.h"
 
@@ -67,9 +69,9 @@ class FeaturePerFrame
 class FeaturePerId
 {
   public:
-    const int feature_id;
+    int feature_id;   // 在LandmarkStore里要能移动赋值，不声明为const
     int start_frame;
-    vector<FeaturePerFrame> feature_per_frame;
+    vector<FeaturePerFrame> feature_per_frame;   // 最多WINDOW_SIZE + 1个观测，构造时一次分配
     int used_num;
     double estimated_depth;
     int solve_flag; // 0 haven't solve yet; 1 solve succ; 2 solve fail;
@@ -78,6 +80,7 @@ class FeaturePerId
         : feature_id(_feature_id), start_frame(_start_frame),
           used_num(0), estimated_depth(-1.0), solve_flag(0)
     {
+        feature_per_frame.reserve(WINDOW_SIZE + 1);
     }
 
     int endFrame();
@@ -91,14 +94,22 @@ public:
     lineFeaturePerFrame(const Vector4d &line)
     {
         lineobs = line;
+        is_stereo = false;
     }
     lineFeaturePerFrame(const Vector8d &line)
     {
         lineobs = line.head<4>();
         lineobs_R = line.tail<4>();
+        is_stereo = true;
+    }
+    void rightObservation(const Vector4d &line) // 右目观测
+    {
+        lineobs_R = line;
+        is_stereo = true;
     }
     Vector4d lineobs;   // 每一帧上的观测
     Vector4d lineobs_R;
+    bool is_stereo;
     double z;
     bool is_used;
     double parallax;
@@ -110,7 +121,7 @@ public:
 class lineFeaturePerId
 {
 public:
-    const int feature_id;
+    int feature_id;
     int start_frame;
 
     //  feature_per_frame 是个向量容器，存着这个特征在每一帧上的观测量。
@@ -139,13 +150,15 @@ public:
 
     lineFeaturePerId(int _feature_id, int _start_frame)
             : feature_id(_feature_id), start_frame(_start_frame),
-              used_num(0), solve_flag(0),is_triangulation(false)
+              used_num(0), is_outlier(false), solve_flag(0),is_triangulation(false)
     {
+        linefeature_per_frame.reserve(WINDOW_SIZE + 1);
         removed_cnt = 0;
         all_obs_cnt = 1;
     }
 
     int endFrame();
+    bool isSolvable();
 };
 
 
@@ -169,19 +182,13 @@ class FeatureManager
 
     double reprojection_error( Vector4d obs, Matrix3d Rwc, Vector3d twc, Vector6d line_w );
     void removeLineOutlier(Vector3d Ps[], Vector3d tic[], Matrix3d ric[]);
-    void removeLineOutlier();
-
-    // mono line
-    bool addFeatureCheckParallax(int frame_count, 
-                                 const map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> &image, 
-                                 const map<int, vector<pair<int, Vector4d>>> &lines, 
-                                 double td);
-    // stereo line
-    // bool addFeatureCheckParallax(int frame_count, const map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> &image, const map<int, vector<pair<int, Vector8d>>> &lines, double td);
+
+    // point and line, 线的右目观测(相机号1)挂在同一帧的左目观测上
+    bool addFeatureCheckParallax(int frame_count, const FeatureFrame &frame, double td);
     // void debugShow();
 
     void triangulateLine(Vector3d Ps[], Vector3d tic[], Matrix3d ric[]);
-    void triangulateLine(double baseline);  // stereo line
+    void triangulateStereoLine(Vector3d tic[], Matrix3d ric[]);  // stereo line
     // -------------------------end-------------------------------------
 
 
@@ -205,8 +212,9 @@ class FeatureManager
     void removeFront(int frame_count);
     void removeOutlier(set<int> &outlierIndex);
     
-    list<FeaturePerId>      feature;
-    list<lineFeaturePerId>  linefeature;
+    // 按feature_id索引、连续存放，删除统一用removeIf
+    LandmarkStore<FeaturePerId>      feature;
+    LandmarkStore<lineFeaturePerId>  linefeature;
 
 
     int last_track_num;
@@ -216,6 +224,7 @@ class FeatureManager
 
   private:
     double compensatedParallax2(const FeaturePerId &it_per_id, int frame_count);
+    void removeUnobserved();
     const Matrix3d *Rs;
     Matrix3d ric[2]; // 2代表 NUM_OF_CAM
 };
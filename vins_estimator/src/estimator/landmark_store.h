@@ -0,0 +1,102 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <eigen3/Eigen/StdVector>
+
+/**
+ * 按feature_id索引的路标容器，替代list + find_if的线性查找。
+ * 路标连续存放在一个数组里，遍历时没有链表的指针跳转；feature_id到数组下标用开放寻址(线性探测)的哈希表查找。
+ * 删除用removeIf批量做：保持原有顺序压缩数组后重建哈希表，遍历中不能直接删除。
+ * insert可能让数组重新分配，之前拿到的指针和迭代器失效
+ */
+template <typename T>
+class LandmarkStore
+{
+  public:
+    typedef std::vector<T, Eigen::aligned_allocator<T>> Container;
+    typedef typename Container::iterator iterator;
+    typedef typename Container::const_iterator const_iterator;
+
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+
+    void clear()
+    {
+        items_.clear();
+        std::fill(table_.begin(), table_.end(), -1);
+    }
+
+    // 没有这个id时返回nullptr
+    T *find(int id)
+    {
+        if (table_.empty())
+            return nullptr;
+        for (size_t k = hash(id);; k = (k + 1) & (table_.size() - 1))
+        {
+            int idx = table_[k];
+            if (idx < 0)
+                return nullptr;
+            if (items_[idx].feature_id == id)
+                return &items_[idx];
+        }
+    }
+
+    // 调用者保证id不存在
+    T &insert(T &&landmark)
+    {
+        if (2 * (items_.size() + 1) > table_.size())   // 装载率不超过1/2
+            rehash(std::max<size_t>(64, 2 * table_.size()));
+        items_.push_back(std::move(landmark));
+        place(items_.size() - 1);
+        return items_.back();
+    }
+
+    template <typename Pred>
+    void removeIf(Pred pred)
+    {
+        size_t n = items_.size();
+        items_.erase(std::remove_if(items_.begin(), items_.end(), pred), items_.end());
+        if (items_.size() != n)
+            rehash(table_.size());
+    }
+
+  private:
+    size_t hash(int id) const
+    {
+        return (uint32_t(id) * 2654435761u) & (table_.size() - 1);
+    }
+
+    void place(size_t idx)
+    {
+        size_t k = hash(items_[idx].feature_id);
+        while (table_[k] >= 0)
+            k = (k + 1) & (table_.size() - 1);
+        table_[k] = idx;
+    }
+
+    // capacity为2的幂
+    void rehash(size_t capacity)
+    {
+        table_.assign(capacity, -1);
+        for (size_t i = 0; i < items_.size(); i++)
+            place(i);
+    }
+
+    Container items_;
+    std::vector<int> table_;   // 数组下标，-1为空
+};
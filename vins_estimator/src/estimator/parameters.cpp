@@ -23,6 +23,9 @@ double BIAS_ACC_THRESHOLD;
 double BIAS_GYR_THRESHOLD;
 double SOLVER_TIME;
 int NUM_ITERATIONS;
+int NUM_SOLVER_THREADS;
+int USE_SCHUR_SOLVER;
+int PERSISTENT_PROBLEM;
 int ESTIMATE_EXTRINSIC;
 int ESTIMATE_TD;
 int ROLLING_SHUTTER;
@@ -40,6 +43,7 @@ int NUM_OF_CAM;
 int STEREO;
 int USE_IMU;
 int MULTIPLE_THREAD;
+int FRAME_QUEUE_SIZE;
 map<int, Eigen::Vector3d> pts_gt;
 std::string IMAGE0_TOPIC, IMAGE1_TOPIC;
 std::string FISHEYE_MASK;
@@ -48,7 +52,19 @@ int MAX_CNT;
 int MIN_DIST;
 double F_THRESHOLD;
 int SHOW_TRACK;
+double SHOW_LINE_TRACK;
 int FLOW_BACK;
+int TRACK_THREADS;
+int GRID_DETECT;
+int UNDISTORT_LUT;
+int LINE_ENDPOINT_UNDISTORT;
+int LINE_MID_SAMPLES;
+int LINE_PREDICT_MATCH;
+int STEREO_LINE;
+int LINE_KLT_TRACK;
+int LINE_DETECTOR;
+int LINE_DETECT_TILES;
+int MAX_LINE_CNT;
 
 
 template <typename T>
@@ -89,10 +105,25 @@ void readParameters(std::string config_file)
     MIN_DIST = fsSettings["min_dist"];
     F_THRESHOLD = fsSettings["F_threshold"];
     SHOW_TRACK = fsSettings["show_track"];
+    SHOW_LINE_TRACK = fsSettings["show_line_track"];
     EQUALIZE = fsSettings["equalize"]; 
     FLOW_BACK = fsSettings["flow_back"];
+    TRACK_THREADS = fsSettings["track_threads"];
+    GRID_DETECT = fsSettings["grid_detect"];
+    UNDISTORT_LUT = fsSettings["undistort_lut"];
+    LINE_ENDPOINT_UNDISTORT = fsSettings["line_endpoint_undistort"];
+    LINE_MID_SAMPLES = fsSettings["line_mid_samples"];
+    LINE_PREDICT_MATCH = fsSettings["line_predict_match"];
+    STEREO_LINE = fsSettings["stereo_line"];
+    LINE_KLT_TRACK = fsSettings["line_klt_track"];
+    LINE_DETECTOR = fsSettings["line_detector"];
+    LINE_DETECT_TILES = fsSettings["line_detect_tiles"];
+    MAX_LINE_CNT = fsSettings["max_line_cnt"];
 
     MULTIPLE_THREAD = fsSettings["multiple_thread"];
+    FRAME_QUEUE_SIZE = fsSettings["frame_queue_size"];
+    if (FRAME_QUEUE_SIZE <= 0)
+        FRAME_QUEUE_SIZE = 2;
 
     USE_IMU = fsSettings["imu"];
     printf("USE_IMU: %d\n", USE_IMU);
@@ -111,6 +142,11 @@ void readParameters(std::string config_file)
 
     SOLVER_TIME = fsSettings["max_solver_time"];
     NUM_ITERATIONS = fsSettings["max_num_iterations"];
+    NUM_SOLVER_THREADS = fsSettings["num_solver_threads"];
+    if (NUM_SOLVER_THREADS < 1)
+        NUM_SOLVER_THREADS = 1;
+    USE_SCHUR_SOLVER = fsSettings["schur_solver"];
+    PERSISTENT_PROBLEM = fsSettings["persistent_problem"];
     MIN_PARALLAX = fsSettings["keyframe_parallax"];
     MIN_PARALLAX = MIN_PARALLAX / FOCAL_LENGTH;
 
@@ -164,6 +200,11 @@ void readParameters(std::string config_file)
     std::string cam0Path = configPath + "/" + cam0Calib;
     CAM_NAMES.push_back(cam0Path);
 
+    // 可选的鱼眼掩模图(白色为有效区域)，路径相对配置文件
+    std::string fisheyeMask;
+    fsSettings["fisheye_mask"] >> fisheyeMask;
+    FISHEYE_MASK = fisheyeMask.empty() ? "" : configPath + "/" + fisheyeMask;
+
     if(NUM_OF_CAM == 2)
     {
         STEREO = 1;
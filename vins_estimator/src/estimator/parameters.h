@@ -49,6 +49,9 @@ extern double BIAS_ACC_THRESHOLD;
 extern double BIAS_GYR_THRESHOLD;
 extern double SOLVER_TIME;
 extern int NUM_ITERATIONS;
+extern int NUM_SOLVER_THREADS;
+extern int USE_SCHUR_SOLVER;
+extern int PERSISTENT_PROBLEM;
 extern std::string EX_CALIB_RESULT_PATH;
 extern std::string VINS_RESULT_PATH;
 extern std::string OUTPUT_FOLDER;
@@ -62,6 +65,7 @@ extern int NUM_OF_CAM;
 extern int STEREO;
 extern int USE_IMU;
 extern int MULTIPLE_THREAD;
+extern int FRAME_QUEUE_SIZE;
 // pts_gt for debug purpose;
 extern map<int, Eigen::Vector3d> pts_gt;
 
@@ -72,8 +76,20 @@ extern int MAX_CNT;
 extern int MIN_DIST;
 extern double F_THRESHOLD;
 extern int SHOW_TRACK;
+extern double SHOW_LINE_TRACK;
 extern int EQUALIZE; 
 extern int FLOW_BACK;
+extern int TRACK_THREADS;
+extern int GRID_DETECT;
+extern int UNDISTORT_LUT;
+extern int LINE_ENDPOINT_UNDISTORT;
+extern int LINE_MID_SAMPLES;
+extern int LINE_PREDICT_MATCH;
+extern int STEREO_LINE;
+extern int LINE_KLT_TRACK;
+extern int LINE_DETECTOR;
+extern int LINE_DETECT_TILES;
+extern int MAX_LINE_CNT;
 
 void readParameters(std::string config_file);
 
@@ -0,0 +1,472 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#include "sliding_window_solver.h"
+
+#include <cmath>
+#include <algorithm>
+#include "../utility/tic_toc.h"
+
+using namespace std;
+
+// 和ceres的LM一样，对角阻尼的尺度限制在[1e-6, 1e32]
+static double dampingScale(double h)
+{
+    return std::min(std::max(h, 1e-6), 1e32);
+}
+
+// 1~4维的对称正定块用定长矩阵的闭式逆(Eigen对4维及以下展开为余子式)
+template <int N, typename Matrix>
+static bool invertFixed(const Matrix &A, Matrix &A_inv)
+{
+    Eigen::Matrix<double, N, N> a = A, a_inv;
+    bool invertible;
+    double det;
+    a.computeInverseAndDetWithCheck(a_inv, det, invertible, 1e-20);
+    A_inv = a_inv;
+    return invertible;
+}
+
+template <typename Matrix>
+static bool invertSmall(const Matrix &A, Matrix &A_inv)
+{
+    switch (A.rows())
+    {
+    case 1:
+        if (std::fabs(A(0, 0)) < 1e-20)
+            return false;
+        A_inv.resize(1, 1);
+        A_inv(0, 0) = 1.0 / A(0, 0);
+        return true;
+    case 2:
+        return invertFixed<2>(A, A_inv);
+    case 3:
+        return invertFixed<3>(A, A_inv);
+    case 4:
+        return invertFixed<4>(A, A_inv);
+    }
+    return false;
+}
+
+bool SlidingWindowSolver::setup(ceres::Problem &problem, const vector<double *> &landmarks)
+{
+    blocks_.clear();
+    landmarks_.clear();
+    residuals_.clear();
+
+    unordered_map<const double *, bool> is_landmark;
+    for (double *l : landmarks)
+        is_landmark[l] = true;
+
+    vector<double *> parameter_blocks;
+    problem.GetParameterBlocks(&parameter_blocks);
+    unordered_map<const double *, int> block_index;
+    frame_dim_ = 0;
+    int state_size = 0;
+    for (double *x : parameter_blocks)
+    {
+        if (problem.IsParameterBlockConstant(x))
+            continue;
+        Block blk;
+        blk.x = x;
+        blk.size = problem.ParameterBlockSize(x);
+        blk.local_size = problem.ParameterBlockLocalSize(x);
+        blk.parameterization = problem.GetParameterization(x);
+        blk.state = state_size;
+        state_size += blk.size;
+        if (blk.parameterization)
+            blk.P.resize(blk.size, blk.local_size);
+        if (is_landmark.count(x))
+        {
+            if (blk.size > MAX_LANDMARK_SIZE)
+                return false;
+            blk.offset = -1;
+            blk.landmark = landmarks_.size();
+            landmarks_.emplace_back();
+            landmarks_.back().block = blocks_.size();
+        }
+        else
+        {
+            blk.offset = frame_dim_;
+            blk.landmark = -1;
+            frame_dim_ += blk.local_size;
+        }
+        block_index[x] = blocks_.size();
+        blocks_.push_back(blk);
+    }
+    state_.resize(state_size);
+
+    vector<ceres::ResidualBlockId> residual_ids;
+    problem.GetResidualBlocks(&residual_ids);
+    residuals_.resize(residual_ids.size());
+    size_t max_params = 0;
+    for (size_t i = 0; i < residual_ids.size(); i++)
+    {
+        Residual &res = residuals_[i];
+        res.cost = problem.GetCostFunctionForResidualBlock(residual_ids[i]);
+        res.loss = problem.GetLossFunctionForResidualBlock(residual_ids[i]);
+        problem.GetParameterBlocksForResidualBlock(residual_ids[i], &res.parameters);
+        res.landmark = -1;
+        res.landmark_param = -1;
+        res.r.resize(res.cost->num_residuals());
+        res.blocks.assign(res.parameters.size(), -1);
+        res.frame_in_landmark.assign(res.parameters.size(), -1);
+        max_params = max(max_params, res.parameters.size());
+
+        for (size_t k = 0; k < res.parameters.size(); k++)
+        {
+            auto it = block_index.find(res.parameters[k]);
+            if (it == block_index.end())
+                continue;
+            res.blocks[k] = it->second;
+            if (blocks_[it->second].landmark >= 0)
+            {
+                if (res.landmark >= 0)   // 一个残差连了两个路标，不能逐个消元
+                    return false;
+                res.landmark = blocks_[it->second].landmark;
+                res.landmark_param = k;
+            }
+        }
+
+        if (res.landmark < 0)
+        {
+            res.J.resize(res.parameters.size());
+            res.J_local.resize(res.parameters.size());
+            for (size_t k = 0; k < res.parameters.size(); k++)
+            {
+                if (res.blocks[k] < 0)
+                    continue;
+                const Block &blk = blocks_[res.blocks[k]];
+                res.J[k].resize(res.r.size(), blk.size);
+                res.J_local[k].resize(res.r.size(), blk.local_size);
+            }
+            continue;
+        }
+
+        // 路标残差的块超过定长上限时不用这个求解器
+        if (res.r.size() > MAX_LANDMARK_RESIDUAL)
+            return false;
+        res.Jl.resize(res.parameters.size());
+        res.Jl_local.resize(res.parameters.size());
+        Landmark &lm = landmarks_[res.landmark];
+        for (size_t k = 0; k < res.parameters.size(); k++)
+        {
+            if (res.blocks[k] < 0)
+                continue;
+            const Block &blk = blocks_[res.blocks[k]];
+            if (blk.size > MAX_FRAME_SIZE || blk.local_size > MAX_FRAME_LOCAL_SIZE)
+                return false;
+            res.Jl[k].resize(res.r.size(), blk.size);
+            res.Jl_local[k].resize(res.r.size(), blk.local_size);
+            if ((int)k == res.landmark_param)
+                continue;
+
+            // 记下残差里的帧参数块在路标的哪个W上
+            auto it = std::find(lm.frames.begin(), lm.frames.end(), res.blocks[k]);
+            res.frame_in_landmark[k] = it - lm.frames.begin();
+            if (it == lm.frames.end())
+                lm.frames.push_back(res.blocks[k]);
+        }
+    }
+    jacobian_ptrs_.resize(max_params);
+
+    for (Landmark &lm : landmarks_)
+    {
+        int n = blocks_[lm.block].local_size;
+        lm.W.resize(lm.frames.size());
+        for (size_t k = 0; k < lm.frames.size(); k++)
+            lm.W[k].resize(n, blocks_[lm.frames[k]].local_size);
+    }
+    H_.resize(frame_dim_, frame_dim_);
+    b_.resize(frame_dim_);
+    D_f_.resize(frame_dim_);
+    return true;
+}
+
+// 鲁棒核加权的局部雅可比 J_local = w * J * P
+template <typename Jacobians, typename LocalJacobians>
+void SlidingWindowSolver::localJacobians(const Residual &res, double w, const Jacobians &J, LocalJacobians &J_local)
+{
+    for (size_t k = 0; k < res.parameters.size(); k++)
+    {
+        if (res.blocks[k] < 0)
+            continue;
+        const Block &blk = blocks_[res.blocks[k]];
+        if (blk.parameterization)
+            J_local[k].noalias() = w * J[k] * blk.P;
+        else
+            J_local[k] = w * J[k];
+    }
+}
+
+/**
+ * 计算所有残差，返回总代价。jacobians为false时只算代价(试探步)，
+ * 为true时重新线性化：局部参数化雅可比每个块算一次，再算各残差鲁棒核加权后的局部雅可比
+ */
+bool SlidingWindowSolver::evaluate(bool jacobians, double *cost)
+{
+    *cost = 0;
+    if (jacobians)
+    {
+        for (Block &blk : blocks_)
+            if (blk.parameterization)
+                blk.parameterization->ComputeJacobian(blk.x, blk.P.data());
+    }
+    for (Residual &res : residuals_)
+    {
+        for (size_t k = 0; k < res.parameters.size(); k++)
+        {
+            if (!jacobians || res.blocks[k] < 0)
+                jacobian_ptrs_[k] = nullptr;
+            else
+                jacobian_ptrs_[k] = res.landmark >= 0 ? res.Jl[k].data() : res.J[k].data();
+        }
+        if (!res.cost->Evaluate(res.parameters.data(), res.r.data(), jacobians ? jacobian_ptrs_.data() : nullptr))
+            return false;
+
+        double sq_norm = res.r.squaredNorm();
+        double rho[3] = {sq_norm, 1.0, 0.0};
+        if (res.loss)
+            res.loss->Evaluate(sq_norm, rho);
+        *cost += 0.5 * rho[0];
+        if (!std::isfinite(rho[0]))
+            return false;
+        if (!jacobians)
+            continue;
+
+        // 鲁棒核按IRLS处理：残差和雅可比乘sqrt(rho')，收敛点和ceres相同
+        double w = std::sqrt(std::max(rho[1], 0.0));
+        res.r *= w;
+        if (res.landmark >= 0)
+            localJacobians(res, w, res.Jl, res.Jl_local);
+        else
+            localJacobians(res, w, res.J, res.J_local);
+    }
+    return true;
+}
+
+// 在当前线性化点累加法方程：帧参数部分H_, b_，每个路标的H, b和W = H_lf
+void SlidingWindowSolver::buildSystem()
+{
+    H_.setZero();
+    b_.setZero();
+    for (Landmark &lm : landmarks_)
+    {
+        int n = blocks_[lm.block].local_size;
+        lm.H.setZero(n, n);
+        lm.b.setZero(n);
+        for (CouplingMatrix &W : lm.W)
+            W.setZero();
+    }
+
+    for (const Residual &res : residuals_)
+    {
+        if (res.landmark >= 0)
+            accumulate(res, res.Jl_local);
+        else
+            accumulate(res, res.J_local);
+    }
+}
+
+// 一个残差对法方程的贡献
+template <typename LocalJacobians>
+void SlidingWindowSolver::accumulate(const Residual &res, const LocalJacobians &J_local)
+{
+    for (size_t a = 0; a < res.parameters.size(); a++)
+    {
+        if (res.blocks[a] < 0 || (int)a == res.landmark_param)
+            continue;
+        const Block &ba = blocks_[res.blocks[a]];
+        const auto &Ja = J_local[a];
+        b_.segment(ba.offset, ba.local_size).noalias() -= Ja.transpose() * res.r;
+        for (size_t c = 0; c < res.parameters.size(); c++)
+        {
+            if (res.blocks[c] < 0 || (int)c == res.landmark_param)
+                continue;
+            const Block &bc = blocks_[res.blocks[c]];
+            H_.block(ba.offset, bc.offset, ba.local_size, bc.local_size).noalias() += Ja.transpose() * J_local[c];
+        }
+        if (res.landmark >= 0)
+            landmarks_[res.landmark].W[res.frame_in_landmark[a]].noalias() +=
+                J_local[res.landmark_param].transpose() * Ja;
+    }
+    if (res.landmark >= 0)
+    {
+        Landmark &lm = landmarks_[res.landmark];
+        const auto &Jl = J_local[res.landmark_param];
+        lm.H.noalias() += Jl.transpose() * Jl;
+        lm.b.noalias() -= Jl.transpose() * res.r;
+    }
+}
+
+/**
+ * 解阻尼后的法方程 (H + lambda * diag(H)) dx = b。
+ * 路标逐个消元：S = H_ff - sum(W^T H_ll^-1 W)，g = b_f - sum(W^T H_ll^-1 b_l)，
+ * S用稠密Cholesky分解，路标增量 dx_l = H_ll^-1 (b_l - W dx_f)
+ */
+bool SlidingWindowSolver::computeStep(double lambda)
+{
+    S_ = H_;
+    g_ = b_;
+    double damped = 0;   // sum(lambda * D * dx^2)，用来算模型预测的下降
+    for (int i = 0; i < frame_dim_; i++)
+    {
+        D_f_(i) = lambda * dampingScale(H_(i, i));
+        S_(i, i) += D_f_(i);
+    }
+
+    for (Landmark &lm : landmarks_)
+    {
+        LandmarkMatrix H = lm.H;
+        for (int i = 0; i < H.rows(); i++)
+            H(i, i) += lambda * dampingScale(lm.H(i, i));
+        if (!invertSmall(H, lm.H_inv))
+            return false;
+        LandmarkVector Hb = lm.H_inv * lm.b;
+        for (size_t p = 0; p < lm.frames.size(); p++)
+        {
+            const Block &bp = blocks_[lm.frames[p]];
+            CouplingTMatrix WtH;
+            WtH.noalias() = lm.W[p].transpose() * lm.H_inv;
+            g_.segment(bp.offset, bp.local_size).noalias() -= lm.W[p].transpose() * Hb;
+            for (size_t q = 0; q < lm.frames.size(); q++)
+            {
+                const Block &bq = blocks_[lm.frames[q]];
+                S_.block(bp.offset, bq.offset, bp.local_size, bq.local_size).noalias() -= WtH * lm.W[q];
+            }
+        }
+    }
+
+    llt_.compute(S_);
+    if (llt_.info() != Eigen::Success)
+        return false;
+    dx_ = llt_.solve(g_);
+    if (!dx_.allFinite())
+        return false;
+
+    double b_dx = b_.dot(dx_);
+    damped += dx_.dot(D_f_.cwiseProduct(dx_));
+    step_norm_ = dx_.squaredNorm();
+    for (Landmark &lm : landmarks_)
+    {
+        LandmarkVector rhs = lm.b;
+        for (size_t p = 0; p < lm.frames.size(); p++)
+        {
+            const Block &bp = blocks_[lm.frames[p]];
+            rhs.noalias() -= lm.W[p] * dx_.segment(bp.offset, bp.local_size);
+        }
+        lm.dx = lm.H_inv * rhs;
+        b_dx += lm.b.dot(lm.dx);
+        for (int i = 0; i < lm.dx.size(); i++)
+            damped += lambda * dampingScale(lm.H(i, i)) * lm.dx(i) * lm.dx(i);
+        step_norm_ += lm.dx.squaredNorm();
+    }
+    step_norm_ = std::sqrt(step_norm_);
+    // 精确求解时 dx^T H dx = b^T dx - dx^T lambda D dx，代入 b^T dx - 0.5 dx^T H dx
+    model_reduction_ = 0.5 * (b_dx + damped);
+    return true;
+}
+
+void SlidingWindowSolver::saveState()
+{
+    double sq = 0;
+    for (const Block &blk : blocks_)
+    {
+        for (int i = 0; i < blk.size; i++)
+        {
+            state_[blk.state + i] = blk.x[i];
+            sq += blk.x[i] * blk.x[i];
+        }
+    }
+    x_norm_ = std::sqrt(sq);
+}
+
+void SlidingWindowSolver::applyStep()
+{
+    for (const Block &blk : blocks_)
+    {
+        const double *x = &state_[blk.state];
+        const double *delta = blk.landmark >= 0 ? landmarks_[blk.landmark].dx.data() : dx_.data() + blk.offset;
+        if (blk.parameterization)
+            blk.parameterization->Plus(x, delta, blk.x);
+        else
+        {
+            for (int i = 0; i < blk.size; i++)
+                blk.x[i] = x[i] + delta[i];
+        }
+    }
+}
+
+void SlidingWindowSolver::restoreState()
+{
+    for (const Block &blk : blocks_)
+        std::copy(state_.begin() + blk.state, state_.begin() + blk.state + blk.size, blk.x);
+}
+
+bool SlidingWindowSolver::solve(ceres::Problem &problem, const vector<double *> &landmarks,
+                                const Options &options, Summary *summary)
+{
+    TicToc t_solve;
+    *summary = Summary();
+    if (!setup(problem, landmarks))
+        return false;
+
+    double cost;
+    if (!evaluate(true, &cost))
+        return false;
+    buildSystem();
+    summary->initial_cost = cost;
+
+    // LM阻尼按Nielsen的规则更新
+    double lambda = options.initial_lambda, nu = 2;
+    for (int iter = 0; iter < options.max_num_iterations; iter++)
+    {
+        if (t_solve.toc() > options.max_solver_time_in_seconds * 1000)
+            break;
+        summary->iterations++;
+        if (!computeStep(lambda))
+        {
+            lambda *= nu;
+            nu *= 2;
+            continue;
+        }
+
+        // 试探步只算代价，接受后才重新线性化
+        saveState();
+        applyStep();
+        double new_cost;
+        bool valid = evaluate(false, &new_cost);
+        double rho = valid && model_reduction_ > 0 ? (cost - new_cost) / model_reduction_ : -1;
+        if (rho > 1e-3)
+        {
+            bool converged = cost - new_cost < options.function_tolerance * cost ||
+                             step_norm_ < options.parameter_tolerance * (x_norm_ + options.parameter_tolerance);
+            if (!evaluate(true, &new_cost))
+            {
+                restoreState();
+                break;
+            }
+            cost = new_cost;
+            buildSystem();
+            lambda *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * rho - 1.0, 3));
+            nu = 2;
+            if (converged)
+                break;
+        }
+        else
+        {
+            restoreState();   // 残差缓存已经被覆盖，但法方程还是旧线性化点的
+            lambda *= nu;
+            nu *= 2;
+        }
+    }
+    summary->final_cost = cost;
+    summary->total_time_ms = t_solve.toc();
+    return true;
+}
@@ -0,0 +1,132 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <ceres/ceres.h>
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/StdVector>
+
+/**
+ * 滑窗专用的LM求解器，直接求解已经搭好的ceres::Problem(因子、鲁棒核函数、局部参数化都沿用)。
+ * 路标(点的逆深度、线的正交表示)每个只和帧参数块(位姿、速度偏置、外参、td)相连，
+ * 按路标逐个用闭式逆做Schur消元，帧参数的约化系统(维数<200)用稠密Cholesky求解，再回代出路标的增量。
+ * 结构不满足(一个残差连了两个路标、路标残差的块超过定长上限)时solve返回false，由调用者退回ceres::Solve
+ */
+class SlidingWindowSolver
+{
+  public:
+    struct Options
+    {
+        int max_num_iterations = 8;
+        double max_solver_time_in_seconds = 1e6;
+        double function_tolerance = 1e-6;     // 代价相对下降小于该值时收敛
+        double parameter_tolerance = 1e-8;    // 增量相对参数的大小小于该值时收敛
+        double initial_lambda = 1e-4;         // LM阻尼初值，和ceres的初始信赖域半径1e4对应
+    };
+
+    struct Summary
+    {
+        int iterations = 0;      // 包括被拒绝的迭代
+        double initial_cost = 0;
+        double final_cost = 0;
+        double total_time_ms = 0;
+    };
+
+    // landmarks: 要消元的参数块(para_Feature、para_LineFeature)，不在problem里的会被忽略
+    bool solve(ceres::Problem &problem, const std::vector<double *> &landmarks,
+               const Options &options, Summary *summary);
+
+  private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrix;
+    // 路标块最多4维，和路标相连的帧参数块(位姿、外参、td)最多7维、局部6维，
+    // 路标残差(点、线重投影)最多4维；这些块都用定长上限的矩阵，放在栈上或对象里，不走堆
+    enum
+    {
+        MAX_LANDMARK_SIZE = 4,
+        MAX_FRAME_SIZE = 7,
+        MAX_FRAME_LOCAL_SIZE = 6,
+        MAX_LANDMARK_RESIDUAL = 4
+    };
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MAX_LANDMARK_SIZE, MAX_LANDMARK_SIZE> LandmarkMatrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MAX_LANDMARK_SIZE, 1> LandmarkVector;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MAX_LANDMARK_SIZE, MAX_FRAME_LOCAL_SIZE> CouplingMatrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MAX_FRAME_LOCAL_SIZE, MAX_LANDMARK_SIZE> CouplingTMatrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor, MAX_LANDMARK_RESIDUAL, MAX_FRAME_SIZE> LandmarkJacobian;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MAX_LANDMARK_RESIDUAL, MAX_FRAME_LOCAL_SIZE> LandmarkLocalJacobian;
+    typedef std::vector<LandmarkJacobian, Eigen::aligned_allocator<LandmarkJacobian>> LandmarkJacobians;
+    typedef std::vector<LandmarkLocalJacobian, Eigen::aligned_allocator<LandmarkLocalJacobian>> LandmarkLocalJacobians;
+
+    struct Block
+    {
+        double *x;
+        int size, local_size;
+        const ceres::LocalParameterization *parameterization;
+        int offset;      // 帧参数块在约化系统里的位置，路标块为-1
+        int landmark;    // 路标序号，帧参数块为-1
+        int state;       // 在state_里备份的位置
+        RowMatrix P;     // 局部参数化的雅可比，每次线性化算一次
+    };
+
+    struct Landmark
+    {
+        int block;
+        std::vector<int> frames;                 // 相连的帧参数块
+        LandmarkMatrix H, H_inv;
+        LandmarkVector b, dx;
+        std::vector<CouplingMatrix, Eigen::aligned_allocator<CouplingMatrix>> W;   // 每个相连帧参数块的H_lf
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    struct Residual
+    {
+        const ceres::CostFunction *cost;
+        const ceres::LossFunction *loss;
+        std::vector<double *> parameters;
+        std::vector<int> blocks;                 // 各参数对应的Block，常量块为-1
+        std::vector<int> frame_in_landmark;      // 各参数在所连路标frames里的序号
+        int landmark;                            // 所连的路标，没有为-1
+        int landmark_param;                      // 路标在parameters里的位置
+        Eigen::VectorXd r;
+        // 不连路标的残差(IMU、先验)：ceres输出的全局维数雅可比，和乘上局部参数化雅可比、鲁棒核加权后的雅可比
+        std::vector<RowMatrix> J;
+        std::vector<Eigen::MatrixXd> J_local;
+        // 连路标的残差用定长上限的块，含义同上
+        LandmarkJacobians Jl;
+        LandmarkLocalJacobians Jl_local;
+    };
+
+    bool setup(ceres::Problem &problem, const std::vector<double *> &landmarks);
+    bool evaluate(bool jacobians, double *cost);
+    template <typename Jacobians, typename LocalJacobians>
+    void localJacobians(const Residual &res, double w, const Jacobians &J, LocalJacobians &J_local);
+    void buildSystem();
+    template <typename LocalJacobians>
+    void accumulate(const Residual &res, const LocalJacobians &J_local);
+    bool computeStep(double lambda);
+    void saveState();
+    void applyStep();
+    void restoreState();
+
+    std::vector<Block> blocks_;
+    std::vector<Landmark, Eigen::aligned_allocator<Landmark>> landmarks_;
+    std::vector<Residual> residuals_;
+    std::vector<double *> jacobian_ptrs_;
+    std::vector<double> state_;
+    int frame_dim_;
+
+    Eigen::MatrixXd H_, S_;      // 帧参数部分的H，和阻尼、消元后的约化矩阵
+    Eigen::VectorXd b_, g_, dx_, D_f_;
+    Eigen::LLT<Eigen::MatrixXd> llt_;   // 跨迭代复用分解的存储
+    double model_reduction_;     // 线性化模型预测的代价下降
+    double step_norm_, x_norm_;
+};
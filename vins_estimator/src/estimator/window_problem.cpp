@@ -0,0 +1,197 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#include "window_problem.h"
+
+WindowProblem::WindowProblem() : loss_function_(1.0)
+{
+    reset();
+}
+
+void WindowProblem::reset()
+{
+    ceres::Problem::Options options;
+    options.enable_fast_removal = true;   // 按块删除残差时不用扫描整个problem
+    options.local_parameterization_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_.reset(new ceres::Problem(options));
+    blocks_.clear();
+    block_of_.clear();
+    frame_residuals_.clear();
+    landmarks_.clear();
+    num_added_ = 0;
+    num_removed_ = 0;
+}
+
+void WindowProblem::beginFrame()
+{
+    for (auto id : frame_residuals_)
+        problem_->RemoveResidualBlock(id);
+    num_removed_ = frame_residuals_.size();
+    num_added_ = 0;
+    frame_residuals_.clear();
+    block_of_.clear();
+    landmarks_.clear();
+    for (auto &it : blocks_)
+    {
+        it.second.used = false;
+        for (auto &r : it.second.residuals)
+            r.second.used = false;
+    }
+}
+
+double *WindowProblem::addParameterBlock(BlockType type, double key, double *para, int size)
+{
+    auto it = blocks_.find(std::make_pair(int(type), key));
+    if (it == blocks_.end())
+    {
+        it = blocks_.emplace(std::make_pair(int(type), key), Block()).first;
+        Block &block = it->second;
+        block.size = size;
+        block.constant = false;
+        ceres::LocalParameterization *parameterization = nullptr;
+        if (type == POSE || type == EX_POSE)
+            parameterization = &pose_parameterization_;
+        else if (type == LINE)
+            parameterization = &line_parameterization_;
+        problem_->AddParameterBlock(block.x, size, parameterization);
+    }
+    Block &block = it->second;
+    block.used = true;
+    std::copy(para, para + size, block.x);
+    block_of_[para] = &block;
+    if (type == POINT || type == LINE)
+        landmarks_.push_back(block.x);
+    return block.x;
+}
+
+void WindowProblem::setConstant(double *para, bool constant)
+{
+    Block *block = block_of_[para];
+    if (block->constant == constant)
+        return;
+    if (constant)
+        problem_->SetParameterBlockConstant(block->x);
+    else
+        problem_->SetParameterBlockVariable(block->x);
+    block->constant = constant;
+}
+
+bool WindowProblem::bound(const std::vector<double *> &paras) const
+{
+    for (auto para : paras)
+        if (!block_of_.count(para))
+            return false;
+    return true;
+}
+
+std::vector<double *> WindowProblem::mapBlocks(const std::vector<double *> &paras)
+{
+    std::vector<double *> blocks(paras.size());
+    for (size_t i = 0; i < paras.size(); i++)
+        blocks[i] = block_of_[paras[i]]->x;
+    return blocks;
+}
+
+bool WindowProblem::addResidual(ceres::CostFunction *cost, ceres::LossFunction *loss, const std::vector<double *> &paras)
+{
+    if (!bound(paras))
+    {
+        delete cost;
+        return false;
+    }
+    frame_residuals_.push_back(problem_->AddResidualBlock(cost, loss, mapBlocks(paras)));
+    num_added_++;
+    return true;
+}
+
+void WindowProblem::endFrame()
+{
+    // 先处理路标，删帧参数块时就不会连带删掉还记着的路标残差
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (auto it = blocks_.begin(); it != blocks_.end();)
+        {
+            Block &block = it->second;
+            bool landmark = it->first.first == POINT || it->first.first == LINE;
+            if (landmark != (pass == 0))
+            {
+                ++it;
+                continue;
+            }
+            if (!block.used)
+            {
+                num_removed_ += block.residuals.size();
+                problem_->RemoveParameterBlock(block.x);
+                it = blocks_.erase(it);
+                continue;
+            }
+            for (auto r = block.residuals.begin(); r != block.residuals.end();)
+            {
+                if (r->second.used)
+                {
+                    ++r;
+                    continue;
+                }
+                problem_->RemoveResidualBlock(r->second.id);
+                num_removed_++;
+                r = block.residuals.erase(r);
+            }
+            ++it;
+        }
+    }
+}
+
+void WindowProblem::copyBack()
+{
+    for (auto &it : block_of_)
+        std::copy(it.second->x, it.second->x + it.second->size, it.first);
+}
+
+static ceres::Problem::Options frameProblemOptions()
+{
+    ceres::Problem::Options options;   // 因子都在arena里
+    options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    options.local_parameterization_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    return options;
+}
+
+FrameProblem::FrameProblem(FrameArena &arena)
+    : arena_(arena), problem_(frameProblemOptions())
+{
+    loss_function_ = arena_.create<ceres::HuberLoss>(1.0);
+    pose_parameterization_ = arena_.create<PoseLocalParameterization>();
+    line_parameterization_ = arena_.create<LineOrthParameterization>();
+}
+
+double *FrameProblem::addParameterBlock(WindowProblem::BlockType type, double key, double *para, int size)
+{
+    ceres::LocalParameterization *parameterization = nullptr;
+    if (type == WindowProblem::POSE || type == WindowProblem::EX_POSE)
+        parameterization = pose_parameterization_;
+    else if (type == WindowProblem::LINE)
+        parameterization = line_parameterization_;
+    problem_.AddParameterBlock(para, size, parameterization);
+    if (type == WindowProblem::POINT || type == WindowProblem::LINE)
+        landmarks_.push_back(para);
+    return para;
+}
+
+void FrameProblem::setConstant(double *para, bool constant)
+{
+    if (constant)
+        problem_.SetParameterBlockConstant(para);
+}
+
+bool FrameProblem::addResidual(ceres::CostFunction *cost, ceres::LossFunction *loss, const std::vector<double *> &paras)
+{
+    problem_.AddResidualBlock(cost, loss, paras);
+    return true;
+}
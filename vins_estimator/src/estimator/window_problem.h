@@ -0,0 +1,176 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <ceres/ceres.h>
+
+#include "parameters.h"
+#include "../factor/pose_local_parameterization.h"
+#include "../factor/line_parameterization.h"
+#include "../utility/frame_arena.h"
+
+/**
+ * 跨帧常驻的滑窗ceres::Problem，每帧只增删变化的部分。
+ * para_*数组的下标随滑窗移动，ceres的残差块又不能换参数指针，所以参数块放在自己的常驻内存里：
+ * 帧参数按时间戳、路标按feature_id找到。求解前从para_*拷入，求解后copyBack拷回，边缘化等其余代码不变。
+ * 路标残差按(两帧时间戳, 类型)记录，上一帧已有的直接保留；IMU和先验因子每帧重建。
+ * 局部参数化和鲁棒核各只有一个实例，problem不接管所有权。
+ * 残差由Estimator::addWindowFactors枚举，和每帧新建的FrameProblem共用
+ */
+class WindowProblem
+{
+  public:
+    enum BlockType
+    {
+        POSE,
+        SPEED_BIAS,
+        EX_POSE,
+        TD,
+        POINT,
+        LINE
+    };
+    typedef std::tuple<double, double, int> ResidualKey;
+
+    WindowProblem();
+
+    // 清空所有参数块和残差，重启时调用
+    void reset();
+    ceres::Problem &problem() { return *problem_; }
+    ceres::LossFunction *lossFunction() { return &loss_function_; }   // 不归problem所有
+
+    // 因子由problem接管
+    template <typename T, typename... Args>
+    T *create(Args &&... args)
+    {
+        return new T(std::forward<Args>(args)...);
+    }
+
+    // 去掉上一帧的IMU、先验残差，所有参数块和路标残差标记为未使用
+    void beginFrame();
+
+    /**
+     * 参数块：key为帧时间戳、相机序号或feature_id，para为本帧para_*里的位置，值拷入常驻参数块。
+     * 位姿和直线自动带上局部参数化
+     */
+    double *addParameterBlock(BlockType type, double key, double *para, int size);
+    void setConstant(double *para, bool constant);
+
+    /**
+     * 路标的残差，paras里的参数都是para_*指针，landmark为路标的para。
+     * 上一帧加过同样key的残差就保留，否则调用make()新建
+     */
+    template <typename MakeCost>
+    void addLandmarkResidual(double *landmark, const ResidualKey &key, MakeCost make,
+                             const std::vector<double *> &paras)
+    {
+        Block *block = block_of_[landmark];
+        auto it = block->residuals.find(key);
+        if (it != block->residuals.end())
+        {
+            it->second.used = true;
+            return;
+        }
+        Residual &residual = block->residuals[key];
+        residual.id = problem_->AddResidualBlock(make(), &loss_function_, mapBlocks(paras));
+        residual.used = true;
+        num_added_++;
+    }
+
+    // 每帧重建的残差(IMU、先验)，paras没有全部绑定时返回false
+    bool addResidual(ceres::CostFunction *cost, ceres::LossFunction *loss, const std::vector<double *> &paras);
+
+    // 删除本帧没有用到的残差、路标和帧
+    void endFrame();
+
+    // 常驻参数拷回para_*
+    void copyBack();
+
+    // 本帧用到的路标常驻参数块，按加入顺序
+    const std::vector<double *> &landmarks() const { return landmarks_; }
+
+    int numAdded() const { return num_added_; }
+    int numRemoved() const { return num_removed_; }
+
+  private:
+    struct Residual
+    {
+        ceres::ResidualBlockId id;
+        bool used;
+    };
+
+    struct Block
+    {
+        double x[SIZE_SPEEDBIAS];
+        int size;
+        bool used;
+        bool constant;
+        std::map<ResidualKey, Residual> residuals;   // 只有路标有
+    };
+
+    bool bound(const std::vector<double *> &paras) const;
+    std::vector<double *> mapBlocks(const std::vector<double *> &paras);
+
+    PoseLocalParameterization pose_parameterization_;
+    LineOrthParameterization line_parameterization_;
+    ceres::HuberLoss loss_function_;
+
+    std::map<std::pair<int, double>, Block> blocks_;          // map的节点地址不变，x可以常驻problem里
+    std::unordered_map<double *, Block *> block_of_;         // 本帧para_* -> 参数块
+    std::vector<ceres::ResidualBlockId> frame_residuals_;    // 每帧重建的残差
+    std::vector<double *> landmarks_;
+    int num_added_, num_removed_;
+    std::unique_ptr<ceres::Problem> problem_;   // 最后声明，最先析构
+};
+
+/**
+ * PERSISTENT_PROBLEM关闭时每帧新建的滑窗problem，接口和WindowProblem相同。
+ * 因子、局部参数化和鲁棒核都放在FrameArena里，problem不接管所有权；参数块直接用para_*，残差的key不用
+ */
+class FrameProblem
+{
+  public:
+    explicit FrameProblem(FrameArena &arena);
+
+    ceres::Problem &problem() { return problem_; }
+    ceres::LossFunction *lossFunction() { return loss_function_; }   // 边缘化时也要用，随arena释放
+
+    template <typename T, typename... Args>
+    T *create(Args &&... args)
+    {
+        return arena_.create<T>(std::forward<Args>(args)...);
+    }
+
+    double *addParameterBlock(WindowProblem::BlockType type, double key, double *para, int size);
+    void setConstant(double *para, bool constant);
+
+    template <typename MakeCost>
+    void addLandmarkResidual(double *landmark, const WindowProblem::ResidualKey &key, MakeCost make,
+                             const std::vector<double *> &paras)
+    {
+        problem_.AddResidualBlock(make(), loss_function_, paras);
+    }
+
+    bool addResidual(ceres::CostFunction *cost, ceres::LossFunction *loss, const std::vector<double *> &paras);
+
+    const std::vector<double *> &landmarks() const { return landmarks_; }
+
+  private:
+    FrameArena &arena_;
+    ceres::Problem problem_;
+    ceres::LossFunction *loss_function_;
+    ceres::LocalParameterization *pose_parameterization_;
+    ceres::LocalParameterization *line_parameterization_;
+    std::vector<double *> landmarks_;
+};
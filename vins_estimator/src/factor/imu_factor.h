@@ -24,6 +24,8 @@ class IMUFactor : public ceres::SizedCostFunction<15, 7, 9, 7, 9>
     IMUFactor() = delete;
     IMUFactor(IntegrationBase* _pre_integration):pre_integration(_pre_integration)
     {
+        // 预积分在一次求解中不变，信息矩阵只分解一次；Evaluate只读成员，多线程求解时可重入
+        sqrt_info = Eigen::LLT<Eigen::Matrix<double, 15, 15>>(pre_integration->covariance.inverse()).matrixL().transpose();
     }
     virtual bool Evaluate(double const *const *parameters, double *residuals, double **jacobians) const
     {
@@ -70,7 +72,6 @@ class IMUFactor : public ceres::SizedCostFunction<15, 7, 9, 7, 9>
         residual = pre_integration->evaluate(Pi, Qi, Vi, Bai, Bgi,
                                             Pj, Qj, Vj, Baj, Bgj);
 
-        Eigen::Matrix<double, 15, 15> sqrt_info = Eigen::LLT<Eigen::Matrix<double, 15, 15>>(pre_integration->covariance.inverse()).matrixL().transpose();
         //sqrt_info.setIdentity();
         residual = sqrt_info * residual;
 
@@ -193,6 +194,8 @@ class IMUFactor : public ceres::SizedCostFunction<15, 7, 9, 7, 9>
     //void checkTransition();
     //void checkJacobian(double **parameters);
     IntegrationBase* pre_integration;
+    Eigen::Matrix<double, 15, 15> sqrt_info;
 
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
@@ -4,7 +4,6 @@
 #include "../utility/utility.h"
 
 Eigen::Matrix2d lineProjectionFactor::sqrt_info;
-double lineProjectionFactor::sum_t;
 
 lineProjectionFactor::lineProjectionFactor(const Eigen::Vector4d &_obs_i) : obs_i(_obs_i)
 {
@@ -231,7 +230,7 @@ bool lineProjectionFactor::Evaluate(double const *const *parameters, double *res
 
 
 //////////////////////////////////////////////////
-Eigen::Matrix2d lineProjectionFactor_incamera::sqrt_info;
+Eigen::Matrix2d lineProjectionFactor_incamera::sqrt_info = Eigen::Matrix2d::Identity();   // 不加权
 lineProjectionFactor_incamera::lineProjectionFactor_incamera(const Eigen::Vector4d &_obs_i) : obs_i(_obs_i)
 {
 };
@@ -282,7 +281,6 @@ bool lineProjectionFactor_incamera::Evaluate(double const *const *parameters, do
     residual(0) = e1/l_sqrtnorm;
     residual(1) = e2/l_sqrtnorm;
 
-    sqrt_info.setIdentity();
     residual = sqrt_info * residual;
     //std::cout<< residual <<std::endl;
     if (jacobians)
@@ -511,7 +509,7 @@ bool lineProjectionFactor_incamera::Evaluate(double const *const *parameters, do
 }
 
 
-Eigen::Matrix2d lineProjectionFactor_instartframe::sqrt_info;
+Eigen::Matrix2d lineProjectionFactor_instartframe::sqrt_info = Eigen::Matrix2d::Identity();
 lineProjectionFactor_instartframe::lineProjectionFactor_instartframe(const Eigen::Vector4d &_obs_i) : obs_i(_obs_i)
 {
 };
@@ -540,7 +538,6 @@ bool lineProjectionFactor_instartframe::Evaluate(double const *const *parameters
     residual(0) = e1/l_sqrtnorm;
     residual(1) = e2/l_sqrtnorm;
 
-    sqrt_info.setIdentity();
     residual = sqrt_info * residual;
     //std::cout<< residual <<std::endl;
     if (jacobians)
@@ -13,7 +13,6 @@ class lineProjectionFactor : public ceres::SizedCostFunction<2, 7, 7, 4>
     Eigen::Vector4d obs_i;
     Eigen::Matrix<double, 2, 3> tangent_base;
     static Eigen::Matrix2d sqrt_info;
-    static double sum_t;
 };
 
 ///////////////////////////////line in camera frame///////////////////////////////////////////
@@ -27,7 +26,6 @@ public:
     Eigen::Vector4d obs_i;
     Eigen::Matrix<double, 2, 3> tangent_base;
     static Eigen::Matrix2d sqrt_info;
-    static double sum_t;
 };
 class lineProjectionFactor_instartframe : public ceres::SizedCostFunction<2, 4>
 {
@@ -39,5 +37,4 @@ public:
     Eigen::Vector4d obs_i;
     Eigen::Matrix<double, 2, 3> tangent_base;
     static Eigen::Matrix2d sqrt_info;
-    static double sum_t;
 };
\ No newline at end of file
@@ -9,18 +9,33 @@
 
 #include "marginalization_factor.h"
 
-void ResidualBlockInfo::Evaluate()
+void ResidualBlockInfo::Evaluate(FrameArena *arena)
 {
-    residuals.resize(cost_function->num_residuals());
-
-    std::vector<int> block_sizes = cost_function->parameter_block_sizes();
-    raw_jacobians = new double *[block_sizes.size()];
-    jacobians.resize(block_sizes.size());
+    const std::vector<int> &block_sizes = cost_function->parameter_block_sizes();
+    int num_residuals = cost_function->num_residuals();
+    int data_size = num_residuals;
+    for (int size : block_sizes)
+        data_size += num_residuals * size;
+    if (arena)
+    {
+        raw_jacobians = arena->allocate<double *>(block_sizes.size());
+        jacobian_data = arena->allocate<double>(data_size);
+    }
+    else
+    {
+        raw_jacobians = new double *[block_sizes.size()];
+        jacobian_data = new double[data_size];
+    }
 
+    new (&residuals) Eigen::Map<Eigen::VectorXd>(jacobian_data, num_residuals);
+    jacobians.clear();
+    jacobians.reserve(block_sizes.size());
+    double *data = jacobian_data + num_residuals;
     for (int i = 0; i < static_cast<int>(block_sizes.size()); i++)
     {
-        jacobians[i].resize(cost_function->num_residuals(), block_sizes[i]);
-        raw_jacobians[i] = jacobians[i].data();
+        jacobians.emplace_back(data, num_residuals, block_sizes[i]);
+        raw_jacobians[i] = data;
+        data += num_residuals * block_sizes[i];
         //dim += block_sizes[i] == 7 ? 6 : block_sizes[i];
     }
     cost_function->Evaluate(parameter_blocks.data(), residuals.data(), raw_jacobians);
@@ -80,14 +95,17 @@ void ResidualBlockInfo::Evaluate()
 MarginalizationInfo::~MarginalizationInfo()
 {
     //ROS_WARN("release marginlizationinfo");
-    
+    if (arena)   // 都在arena里，arena复用时统一析构
+        return;
+
     for (auto it = parameter_block_data.begin(); it != parameter_block_data.end(); ++it)
-        delete it->second;
+        delete[] it->second;
 
     for (int i = 0; i < (int)factors.size(); i++)
     {
 
         delete[] factors[i]->raw_jacobians;
+        delete[] factors[i]->jacobian_data;
         
         delete factors[i]->cost_function;
 
@@ -100,7 +118,7 @@ void MarginalizationInfo::addResidualBlockInfo(ResidualBlockInfo *residual_block
     factors.emplace_back(residual_block_info);
 
     std::vector<double *> &parameter_blocks = residual_block_info->parameter_blocks;
-    std::vector<int> parameter_block_sizes = residual_block_info->cost_function->parameter_block_sizes();
+    const std::vector<int> &parameter_block_sizes = residual_block_info->cost_function->parameter_block_sizes();
 
     for (int i = 0; i < static_cast<int>(residual_block_info->parameter_blocks.size()); i++)
     {
@@ -120,16 +138,16 @@ void MarginalizationInfo::preMarginalize()
 {
     for (auto it : factors)
     {
-        it->Evaluate();
+        it->Evaluate(arena);
 
-        std::vector<int> block_sizes = it->cost_function->parameter_block_sizes();
+        const std::vector<int> &block_sizes = it->cost_function->parameter_block_sizes();
         for (int i = 0; i < static_cast<int>(block_sizes.size()); i++)
         {
             long addr = reinterpret_cast<long>(it->parameter_blocks[i]);
             int size = block_sizes[i];
             if (parameter_block_data.find(addr) == parameter_block_data.end())
             {
-                double *data = new double[size];
+                double *data = arena ? arena->allocate<double>(size) : new double[size];
                 memcpy(data, it->parameter_blocks[i], sizeof(double) * size);
                 parameter_block_data[addr] = data;
             }
@@ -158,23 +176,23 @@ void* ThreadsConstructA(void* threadsstruct)
             int size_i = p->parameter_block_size[reinterpret_cast<long>(it->parameter_blocks[i])];
             if (size_i == 7)
                 size_i = 6;
-            Eigen::MatrixXd jacobian_i = it->jacobians[i].leftCols(size_i);
+            auto jacobian_i = it->jacobians[i].leftCols(size_i);   // 直接引用，不拷贝
             for (int j = i; j < static_cast<int>(it->parameter_blocks.size()); j++)
             {
                 int idx_j = p->parameter_block_idx[reinterpret_cast<long>(it->parameter_blocks[j])];
                 int size_j = p->parameter_block_size[reinterpret_cast<long>(it->parameter_blocks[j])];
                 if (size_j == 7)
                     size_j = 6;
-                Eigen::MatrixXd jacobian_j = it->jacobians[j].leftCols(size_j);
+                auto jacobian_j = it->jacobians[j].leftCols(size_j);
                 if (i == j)
-                    p->A.block(idx_i, idx_j, size_i, size_j) += jacobian_i.transpose() * jacobian_j;
+                    p->A.block(idx_i, idx_j, size_i, size_j).noalias() += jacobian_i.transpose() * jacobian_j;
                 else
                 {
-                    p->A.block(idx_i, idx_j, size_i, size_j) += jacobian_i.transpose() * jacobian_j;
+                    p->A.block(idx_i, idx_j, size_i, size_j).noalias() += jacobian_i.transpose() * jacobian_j;
                     p->A.block(idx_j, idx_i, size_j, size_i) = p->A.block(idx_i, idx_j, size_i, size_j).transpose();
                 }
             }
-            p->b.segment(idx_i, size_i) += jacobian_i.transpose() * it->residuals;
+            p->b.segment(idx_i, size_i).noalias() += jacobian_i.transpose() * it->residuals;
         }
     }
     return threadsstruct;
@@ -18,15 +18,20 @@
 
 #include "../utility/utility.h"
 #include "../utility/tic_toc.h"
+#include "../utility/frame_arena.h"
 
 const int NUM_THREADS = 4;
 
 struct ResidualBlockInfo
 {
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMatrix;
+
     ResidualBlockInfo(ceres::CostFunction *_cost_function, ceres::LossFunction *_loss_function, std::vector<double *> _parameter_blocks, std::vector<int> _drop_set)
-        : cost_function(_cost_function), loss_function(_loss_function), parameter_blocks(_parameter_blocks), drop_set(_drop_set) {}
+        : cost_function(_cost_function), loss_function(_loss_function), parameter_blocks(std::move(_parameter_blocks)), drop_set(std::move(_drop_set)),
+          raw_jacobians(nullptr), jacobian_data(nullptr), residuals(nullptr, 0) {}
 
-    void Evaluate();
+    // arena不为空时残差、雅可比从arena里分配
+    void Evaluate(FrameArena *arena = nullptr);
 
     ceres::CostFunction *cost_function;
     ceres::LossFunction *loss_function;
@@ -34,8 +39,9 @@ struct ResidualBlockInfo
     std::vector<int> drop_set;
 
     double **raw_jacobians;
-    std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> jacobians;
-    Eigen::VectorXd residuals;
+    double *jacobian_data;   // 残差和各参数块的雅可比连续存放
+    std::vector<Eigen::Map<RowMatrix>> jacobians;
+    Eigen::Map<Eigen::VectorXd> residuals;
 
     int localSize(int size)
     {
@@ -55,7 +61,7 @@ struct ThreadsStruct
 class MarginalizationInfo
 {
   public:
-    MarginalizationInfo(){valid = true;};
+    MarginalizationInfo(FrameArena *_arena = nullptr) : arena(_arena) {valid = true;};
     ~MarginalizationInfo();
     int localSize(int size) const;
     int globalSize(int size) const;
@@ -64,6 +70,17 @@ class MarginalizationInfo
     void marginalize();
     std::vector<double *> getParameterBlocks(std::unordered_map<long, double *> &addr_shift);
 
+    // 因子和ResidualBlockInfo用它创建：有arena时放进arena，析构时不逐个delete
+    template <typename T, typename... Args>
+    T *create(Args &&... args)
+    {
+        if (arena)
+            return arena->create<T>(std::forward<Args>(args)...);
+        return new T(std::forward<Args>(args)...);
+    }
+
+    FrameArena *arena;
+
     std::vector<ResidualBlockInfo *> factors;
     int m, n;
     std::unordered_map<long, int> parameter_block_size; //global size
@@ -12,7 +12,6 @@
 #include "projectionOneFrameTwoCamFactor.h"
 
 Eigen::Matrix2d ProjectionOneFrameTwoCamFactor::sqrt_info;
-double ProjectionOneFrameTwoCamFactor::sum_t;
 
 ProjectionOneFrameTwoCamFactor::ProjectionOneFrameTwoCamFactor(const Eigen::Vector3d &_pts_i, const Eigen::Vector3d &_pts_j,
                                                                const Eigen::Vector2d &_velocity_i, const Eigen::Vector2d &_velocity_j,
@@ -41,7 +40,6 @@ ProjectionOneFrameTwoCamFactor::ProjectionOneFrameTwoCamFactor(const Eigen::Vect
 
 bool ProjectionOneFrameTwoCamFactor::Evaluate(double const *const *parameters, double *residuals, double **jacobians) const
 {
-    TicToc tic_toc;
 
     Eigen::Vector3d tic(parameters[0][0], parameters[0][1], parameters[0][2]);
     Eigen::Quaterniond qic(parameters[0][6], parameters[0][3], parameters[0][4], parameters[0][5]);
@@ -128,7 +126,6 @@ bool ProjectionOneFrameTwoCamFactor::Evaluate(double const *const *parameters, d
                           sqrt_info * velocity_j.head(2);
         }
     }
-    sum_t += tic_toc.toc();
 
     return true;
 }
@@ -45,6 +45,10 @@ void reduceVector(vector<int> &v, vector<uchar> status)
     v.resize(j);
 }
 
+// LK金字塔参数，构建时的winSize须与calcOpticalFlowPyrLK的winSize一致
+static const cv::Size LK_WIN_SIZE(21, 21);
+static const int LK_MAX_LEVEL = 3;
+
 FeatureTracker::FeatureTracker()
 {
     stereo_cam = 0;
@@ -52,9 +56,91 @@ FeatureTracker::FeatureTracker()
     hasPrediction = false;
 }
 
+/**
+ * @brief 构建图像的光流金字塔，本帧所有calcOpticalFlowPyrLK调用共用，避免重复构建
+ */
+void FeatureTracker::buildPyramid(const cv::Mat &img, vector<cv::Mat> &pyr)
+{
+    cv::buildOpticalFlowPyramid(img, pyr, LK_WIN_SIZE, LK_MAX_LEVEL);
+}
+
+/**
+ * @brief LK光流跟踪，点数较多且开启并行(track_threads > 1)时按点分块交给线程池，
+ *        每个点的跟踪相互独立，所以分块结果与整体调用完全一致
+ */
+void FeatureTracker::trackPyrLK(const vector<cv::Mat> &pyr0, const vector<cv::Mat> &pyr1,
+                                const vector<cv::Point2f> &pts0, vector<cv::Point2f> &pts1,
+                                vector<uchar> &status, int max_level, bool use_initial_flow, bool split)
+{
+    const int MIN_PTS_PER_JOB = 32;
+    int flags = use_initial_flow ? cv::OPTFLOW_USE_INITIAL_FLOW : 0;
+    cv::TermCriteria criteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01);
+    int n = pts0.size();
+    int num_jobs = split ? std::min(track_pool.size(), n / MIN_PTS_PER_JOB) : 1;
+    if (num_jobs <= 1)
+    {
+        vector<float> err;
+        cv::calcOpticalFlowPyrLK(pyr0, pyr1, pts0, pts1, status, err, LK_WIN_SIZE, max_level, criteria, flags);
+        return;
+    }
+
+    if (!use_initial_flow)
+        pts1.resize(n);
+    status.resize(n);
+    int step = (n + num_jobs - 1) / num_jobs;
+    vector<std::future<void>> jobs;
+    for (int begin = 0; begin < n; begin += step)
+    {
+        int end = std::min(begin + step, n);
+        jobs.push_back(track_pool.enqueue([&, begin, end]() {
+            vector<cv::Point2f> sub_pts0(pts0.begin() + begin, pts0.begin() + end);
+            vector<cv::Point2f> sub_pts1(pts1.begin() + begin, pts1.begin() + end);
+            vector<uchar> sub_status;
+            vector<float> err;
+            cv::calcOpticalFlowPyrLK(pyr0, pyr1, sub_pts0, sub_pts1, sub_status, err, LK_WIN_SIZE, max_level, criteria, flags);
+            std::copy(sub_pts1.begin(), sub_pts1.end(), pts1.begin() + begin);
+            std::copy(sub_status.begin(), sub_status.end(), status.begin() + begin);
+        }));
+    }
+    for (auto &job : jobs)
+        job.get();
+}
+
+/**
+ * @brief 当前帧左目点到右目的光流匹配，FLOW_BACK时再做右到左的反向检查
+ */
+void FeatureTracker::stereoTrack(const vector<cv::Point2f> &left_pts, vector<cv::Point2f> &right_pts,
+                                 vector<uchar> &status, bool split)
+{
+    right_pts.clear();
+    status.clear();
+    if (left_pts.empty())
+        return;
+
+    // cur left ---- cur right
+    trackPyrLK(cur_pyr, right_pyr, left_pts, right_pts, status, LK_MAX_LEVEL, false, split);
+    // reverse check cur right ---- cur left
+    if(FLOW_BACK)
+    {
+        vector<cv::Point2f> reverseLeftPts;
+        vector<uchar> statusRightLeft;
+        trackPyrLK(right_pyr, cur_pyr, right_pts, reverseLeftPts, statusRightLeft, LK_MAX_LEVEL, false, split);
+        for(size_t i = 0; i < status.size(); i++)
+        {
+            if(status[i] && statusRightLeft[i] && inBorder(right_pts[i]) && distance(left_pts[i], reverseLeftPts[i]) <= 0.5)
+                status[i] = 1;
+            else
+                status[i] = 0;
+        }
+    }
+}
+
 void FeatureTracker::setMask()
 {
-    mask = cv::Mat(row, col, CV_8UC1, cv::Scalar(255));
+    if (!fisheye_mask.empty())
+        mask = fisheye_mask.clone();
+    else
+        mask = cv::Mat(row, col, CV_8UC1, cv::Scalar(255));
 
     // prefer to keep features that are tracked for long time
     vector<pair<int, pair<cv::Point2f, int>>> cnt_pts_id;
@@ -83,7 +169,127 @@ void FeatureTracker::setMask()
     }
 }
 
-double FeatureTracker::distance(cv::Point2f &pt1, cv::Point2f &pt2)
+/**
+ * @brief 栅格版的setMask：栅格边长为MIN_DIST，与setMask的准则相同，
+ *        按跟踪次数从多到少保留与已保留点距离不小于MIN_DIST、且在鱼眼掩模内的点。
+ *        一格里可以有多个点，只比较距离不看是否占用
+ */
+void FeatureTracker::setGrid()
+{
+    grid_size = std::max(MIN_DIST, 1);
+    grid_cols = (col + grid_size - 1) / grid_size;
+    grid_rows = (row + grid_size - 1) / grid_size;
+    grid_head.assign(grid_cols * grid_rows, -1);
+    grid_next.clear();
+    grid_pts.clear();
+
+    vector<pair<int, pair<cv::Point2f, int>>> cnt_pts_id;
+    for (unsigned int i = 0; i < cur_pts.size(); i++)
+        cnt_pts_id.push_back(make_pair(track_cnt[i], make_pair(cur_pts[i], ids[i])));
+
+    sort(cnt_pts_id.begin(), cnt_pts_id.end(), [](const pair<int, pair<cv::Point2f, int>> &a, const pair<int, pair<cv::Point2f, int>> &b)
+         {
+            return a.first > b.first;
+         });
+
+    cur_pts.clear();
+    ids.clear();
+    track_cnt.clear();
+
+    for (auto &it : cnt_pts_id)
+    {
+        if (gridFree(it.second.first))
+        {
+            cur_pts.push_back(it.second.first);
+            ids.push_back(it.second.second);
+            track_cnt.push_back(it.first);
+            gridInsert(it.second.first);
+        }
+    }
+}
+
+int FeatureTracker::gridIndex(const cv::Point2f &pt)
+{
+    int gx = std::min(std::max(int(pt.x) / grid_size, 0), grid_cols - 1);
+    int gy = std::min(std::max(int(pt.y) / grid_size, 0), grid_rows - 1);
+    return gy * grid_cols + gx;
+}
+
+// 在鱼眼掩模内，且所在格和相邻8格中的点与它的距离都不小于MIN_DIST
+bool FeatureTracker::gridFree(const cv::Point2f &pt)
+{
+    if (!fisheye_mask.empty() && fisheye_mask.at<uchar>(pt) == 0)
+        return false;
+    int idx = gridIndex(pt);
+    int gx = idx % grid_cols, gy = idx / grid_cols;
+    for (int y = std::max(gy - 1, 0); y <= std::min(gy + 1, grid_rows - 1); y++)
+        for (int x = std::max(gx - 1, 0); x <= std::min(gx + 1, grid_cols - 1); x++)
+            for (int n = grid_head[y * grid_cols + x]; n >= 0; n = grid_next[n])
+                if (distance(pt, grid_pts[n]) < MIN_DIST)
+                    return false;
+    return true;
+}
+
+void FeatureTracker::gridInsert(const cv::Point2f &pt)
+{
+    int idx = gridIndex(pt);
+    grid_next.push_back(grid_head[idx]);
+    grid_head[idx] = grid_pts.size();
+    grid_pts.push_back(pt);
+}
+
+/**
+ * @brief 只在空栅格内计算Shi-Tomasi响应(cornerMinEigenVal，OpenCV内部为SIMD实现)，
+ *        每格取响应最大的像素作为候选，按响应从大到小插入栅格，耗时与空区域面积成正比
+ * @param  n_max_cnt: 最多补充的点数
+ * @param  pts: 新提取的角点
+ */
+void FeatureTracker::detectGrid(int n_max_cnt, vector<cv::Point2f> &pts)
+{
+    pts.clear();
+    vector<pair<float, cv::Point2f>> candidates;
+    float max_response = 0;
+    cv::Mat eig;
+    for (int gy = 0; gy < grid_rows; gy++)
+        for (int gx = 0; gx < grid_cols; gx++)
+        {
+            if (grid_head[gy * grid_cols + gx] >= 0)
+                continue;
+            cv::Rect cell(gx * grid_size, gy * grid_size, grid_size, grid_size);
+            cell &= cv::Rect(0, 0, col, row);
+            // ROI外的像素参与滤波，格子边界处的响应与整幅图计算时一致
+            cv::cornerMinEigenVal(cur_img(cell), eig, 3);
+            double max_val;
+            cv::Point max_loc;
+            // 鱼眼掩模外的像素不参与取最大值，空掩模时不起作用
+            cv::Mat cell_mask = fisheye_mask.empty() ? cv::Mat() : fisheye_mask(cell);
+            cv::minMaxLoc(eig, NULL, &max_val, NULL, &max_loc, cell_mask);
+            cv::Point2f pt(cell.x + max_loc.x, cell.y + max_loc.y);
+            if (max_val <= 0 || !inBorder(pt))
+                continue;
+            candidates.push_back(make_pair(float(max_val), pt));
+            max_response = std::max(max_response, float(max_val));
+        }
+
+    sort(candidates.begin(), candidates.end(), [](const pair<float, cv::Point2f> &a, const pair<float, cv::Point2f> &b)
+         {
+            return a.first > b.first;
+         });
+
+    // 与goodFeaturesToTrack一致的相对质量阈值，参考值取参与计算的空栅格中的最大响应
+    float min_response = 0.01 * max_response;
+    for (auto &c : candidates)
+    {
+        if (int(pts.size()) >= n_max_cnt || c.first < min_response)
+            break;
+        if (!gridFree(c.second))
+            continue;
+        pts.push_back(c.second);
+        gridInsert(c.second);
+    }
+}
+
+double FeatureTracker::distance(const cv::Point2f &pt1, const cv::Point2f &pt2)
 {
     //printf("pt1: %f %f pt2: %f %f\n", pt1.x, pt1.y, pt2.x, pt2.y);
     double dx = pt1.x - pt2.x;
@@ -121,18 +327,17 @@ FeatureTracker::trackLImage(double _cur_time, const cv::Mat &_img, const cv::Mat
     */
     cur_pts.clear();
     cur_pts_pair_.clear();
+    buildPyramid(cur_img, cur_pyr);
 
     if (prev_pts.size() > 0)
     {
         TicToc t_o;
         vector<uchar> status;
-        vector<float> err;
 
-        if(hasPrediction)  // 利用恒速模型对路标点坐标进行了预测
+        if(hasPrediction)  // 后端预测了路标点在当前帧的位置(单线程恒速模型，多线程IMU递推)
         {
             cur_pts = predict_pts;
-            cv::calcOpticalFlowPyrLK(prev_img, cur_img, prev_pts, cur_pts, status, err, cv::Size(21, 21), 1, 
-            cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01), cv::OPTFLOW_USE_INITIAL_FLOW);
+            trackPyrLK(prev_pyr, cur_pyr, prev_pts, cur_pts, status, 1, true);
             
             int succ_num = 0;
             for (size_t i = 0; i < status.size(); i++)
@@ -141,18 +346,17 @@ FeatureTracker::trackLImage(double _cur_time, const cv::Mat &_img, const cv::Mat
                     succ_num++;
             }
             if (succ_num < 10)
-               cv::calcOpticalFlowPyrLK(prev_img, cur_img, prev_pts, cur_pts, status, err, cv::Size(21, 21), 3);
+               trackPyrLK(prev_pyr, cur_pyr, prev_pts, cur_pts, status, LK_MAX_LEVEL, false);
         }
         else
-            cv::calcOpticalFlowPyrLK(prev_img, cur_img, prev_pts, cur_pts, status, err, cv::Size(21, 21), 3);
+            trackPyrLK(prev_pyr, cur_pyr, prev_pts, cur_pts, status, LK_MAX_LEVEL, false);
         // reverse check
         if(FLOW_BACK)  //从后一帧图像，计算前一帧图像的points，进行额外筛选，提升鲁棒性
         {
             vector<uchar> reverse_status;
             vector<cv::Point2f> reverse_pts = prev_pts;
-            cv::calcOpticalFlowPyrLK(cur_img, prev_img, cur_pts, reverse_pts, reverse_status, err, cv::Size(21, 21), 1, 
-            cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01), cv::OPTFLOW_USE_INITIAL_FLOW);
-            //cv::calcOpticalFlowPyrLK(cur_img, prev_img, cur_pts, reverse_pts, reverse_status, err, cv::Size(21, 21), 3); 
+            trackPyrLK(cur_pyr, prev_pyr, cur_pts, reverse_pts, reverse_status, 1, true);
+            //cv::calcOpticalFlowPyrLK(cur_pyr, prev_pyr, cur_pts, reverse_pts, reverse_status, err, LK_WIN_SIZE, LK_MAX_LEVEL); 
             for(size_t i = 0; i < status.size(); i++)
             {
                 if(status[i] && reverse_status[i] && distance(prev_pts[i], reverse_pts[i]) <= 0.5)
@@ -179,7 +383,16 @@ FeatureTracker::trackLImage(double _cur_time, const cv::Mat &_img, const cv::Mat
     for (auto &n : track_cnt)
         n++;
 
-    if (1)
+    if (GRID_DETECT)
+    {
+        setGrid();
+        int n_max_cnt = MAX_CNT - static_cast<int>(cur_pts.size());
+        if (n_max_cnt > 0)
+            detectGrid(n_max_cnt, n_pts);
+        else
+            n_pts.clear();
+    }
+    else
     {
         TicToc t_m;
         setMask();
@@ -196,15 +409,15 @@ FeatureTracker::trackLImage(double _cur_time, const cv::Mat &_img, const cv::Mat
         }
         else
             n_pts.clear();
+    }
 
-        for (auto &p : n_pts)  //将新提取的点保存
-        {
-            cur_pts.push_back(p);
-            ids.push_back(n_id++);
-            track_cnt.push_back(1);
-        }
-        // printf("feature cnt after add %d\n", (int)ids.size());
+    for (auto &p : n_pts)  //将新提取的点保存
+    {
+        cur_pts.push_back(p);
+        ids.push_back(n_id++);
+        track_cnt.push_back(1);
     }
+    // printf("feature cnt after add %d\n", (int)ids.size());
 
     cur_un_pts = undistortedPts(cur_pts, m_camera[0]);  //去畸变
     pts_velocity = ptsVelocity(ids, cur_un_pts, cur_un_pts_map, prev_un_pts_map);  //计算在归一化相机坐标系下的速度
@@ -222,23 +435,9 @@ FeatureTracker::trackLImage(double _cur_time, const cv::Mat &_img, const cv::Mat
         if(!cur_pts.empty())
         {
             //printf("stereo image; track feature on right image\n");
-            vector<cv::Point2f> reverseLeftPts;
-            vector<uchar> status, statusRightLeft;
-            vector<float> err;
-            // cur left ---- cur right
-            cv::calcOpticalFlowPyrLK(cur_img, rightImg, cur_pts, cur_right_pts, status, err, cv::Size(21, 21), 3);
-            // reverse check cur right ---- cur left
-            if(FLOW_BACK)
-            {
-                cv::calcOpticalFlowPyrLK(rightImg, cur_img, cur_right_pts, reverseLeftPts, statusRightLeft, err, cv::Size(21, 21), 3);
-                for(size_t i = 0; i < status.size(); i++)
-                {
-                    if(status[i] && statusRightLeft[i] && inBorder(cur_right_pts[i]) && distance(cur_pts[i], reverseLeftPts[i]) <= 0.5)
-                        status[i] = 1;
-                    else
-                        status[i] = 0;
-                }
-            }
+            vector<uchar> status;
+            buildPyramid(rightImg, right_pyr);
+            stereoTrack(cur_pts, cur_right_pts, status, true);
 
             ids_right = ids;
             reduceVector(cur_right_pts, status); 
@@ -268,6 +467,7 @@ FeatureTracker::trackLImage(double _cur_time, const cv::Mat &_img, const cv::Mat
         drawTrack(cur_img, rightImg, ids, cur_pts_pair_, cur_right_pts, prevLeftPtsMap);
 
     prev_img = cur_img;
+    prev_pyr.swap(cur_pyr);  // 当前帧金字塔留作下一帧的prev，同时复用其内存
     prev_pts = cur_pts;
     prev_un_pts = cur_un_pts;
     prev_un_pts_map = cur_un_pts_map;
@@ -426,7 +626,7 @@ void FeatureTracker::drawTrack(const cv::Mat &imLeft, const cv::Mat &imRight,
 // end ================================================================================================
  
 
-map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1)
+void FeatureTracker::trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1, FeatureFrame &frame)
 {
     TicToc t_r;
     cur_time = _cur_time;
@@ -436,25 +636,35 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
     cv::Mat rightImg = _img1;
     if (EQUALIZE) 
     {
-        cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(3.0, cv::Size(8, 8));
-        clahe->apply(cur_img, cur_img);
+        // 输入图像可能直接引用ROS消息的内存，均衡化结果写到复用的缓冲区里，不能原地修改
+        if (clahe.empty())
+            clahe = cv::createCLAHE(3.0, cv::Size(8, 8));
+        clahe->apply(_img, equalize_img[0]);
+        cur_img = equalize_img[0];
         if(!rightImg.empty())
-            clahe->apply(rightImg, rightImg);
+        {
+            clahe->apply(_img1, equalize_img[1]);
+            rightImg = equalize_img[1];
+        }
     }
 
     cur_pts.clear();
+    buildPyramid(cur_img, cur_pyr);
+
+    bool stereo_track = !rightImg.empty() && stereo_cam;
+    bool parallel = track_pool.size() > 1;
+    std::future<void> right_pyr_job, stereo_job;
+    if (stereo_track)  // 并行模式下右目金字塔与左目前后帧光流同时构建
+        right_pyr_job = track_pool.enqueue([&]() { buildPyramid(rightImg, right_pyr); });
 
     if (prev_pts.size() > 0)
     {
         TicToc t_o;
         vector<uchar> status;
-        vector<float> err;
         if(hasPrediction)
         {
-            cout << "hasPrediction----------------------------------------------- " << endl;
             cur_pts = predict_pts;
-            cv::calcOpticalFlowPyrLK(prev_img, cur_img, prev_pts, cur_pts, status, err, cv::Size(21, 21), 1, 
-            cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01), cv::OPTFLOW_USE_INITIAL_FLOW);
+            trackPyrLK(prev_pyr, cur_pyr, prev_pts, cur_pts, status, 1, true);
             
             int succ_num = 0;
             for (size_t i = 0; i < status.size(); i++)
@@ -463,18 +673,17 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
                     succ_num++;
             }
             if (succ_num < 10)
-               cv::calcOpticalFlowPyrLK(prev_img, cur_img, prev_pts, cur_pts, status, err, cv::Size(21, 21), 3);
+               trackPyrLK(prev_pyr, cur_pyr, prev_pts, cur_pts, status, LK_MAX_LEVEL, false);
         }
         else
-            cv::calcOpticalFlowPyrLK(prev_img, cur_img, prev_pts, cur_pts, status, err, cv::Size(21, 21), 3);
+            trackPyrLK(prev_pyr, cur_pyr, prev_pts, cur_pts, status, LK_MAX_LEVEL, false);
         // reverse check
         if(FLOW_BACK)
         {
             vector<uchar> reverse_status;
             vector<cv::Point2f> reverse_pts = prev_pts;
-            cv::calcOpticalFlowPyrLK(cur_img, prev_img, cur_pts, reverse_pts, reverse_status, err, cv::Size(21, 21), 1, 
-            cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01), cv::OPTFLOW_USE_INITIAL_FLOW);
-            //cv::calcOpticalFlowPyrLK(cur_img, prev_img, cur_pts, reverse_pts, reverse_status, err, cv::Size(21, 21), 3); 
+            trackPyrLK(cur_pyr, prev_pyr, cur_pts, reverse_pts, reverse_status, 1, true);
+            //cv::calcOpticalFlowPyrLK(cur_pyr, prev_pyr, cur_pts, reverse_pts, reverse_status, err, LK_WIN_SIZE, LK_MAX_LEVEL); 
             for(size_t i = 0; i < status.size(); i++)
             {
                 if(status[i] && reverse_status[i] && distance(prev_pts[i], reverse_pts[i]) <= 0.5)
@@ -499,9 +708,31 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
     for (auto &n : track_cnt)
         n++;
 
-    if (1)
+    // 并行模式：已跟踪点的双目匹配与F矩阵剔除、补点同时进行，新点的双目匹配在补点之后单独做
+    vector<int> stereo_ids;
+    vector<cv::Point2f> stereo_right_pts;
+    vector<uchar> stereo_status;
+    if (stereo_track && parallel)
+    {
+        right_pyr_job.wait();
+        stereo_ids = ids;
+        stereo_job = track_pool.enqueue([&, left_pts = cur_pts]() {
+            stereoTrack(left_pts, stereo_right_pts, stereo_status, false);
+        });
+    }
+
+    rejectWithF(); 
+    if (GRID_DETECT)  // 用栅格占据代替整幅mask，只在空栅格里计算角点响应
+    {
+        setGrid();
+        int n_max_cnt = MAX_CNT - static_cast<int>(cur_pts.size());
+        if (n_max_cnt > 0)
+            detectGrid(n_max_cnt, n_pts);
+        else
+            n_pts.clear();
+    }
+    else
     {
-        rejectWithF(); 
         TicToc t_m;
         setMask();
 
@@ -517,46 +748,64 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
         }
         else
             n_pts.clear();
+    }
 
-        for (auto &p : n_pts)
-        {
-            cur_pts.push_back(p);
-            ids.push_back(n_id++);
-            track_cnt.push_back(1);
-        }
-        //printf("feature cnt after add %d\n", (int)ids.size());
+    for (auto &p : n_pts)
+    {
+        cur_pts.push_back(p);
+        ids.push_back(n_id++);
+        track_cnt.push_back(1);
     }
+    //printf("feature cnt after add %d\n", (int)ids.size());
 
     cur_un_pts = undistortedPts(cur_pts, m_camera[0]);
     pts_velocity = ptsVelocity(ids, cur_un_pts, cur_un_pts_map, prev_un_pts_map);
 
-    if(!_img1.empty() && stereo_cam)
+    if(stereo_track)
     {
         ids_right.clear();
         cur_right_pts.clear();
         cur_un_right_pts.clear();
         right_pts_velocity.clear();
         cur_un_right_pts_map.clear();
+        right_pyr_job.wait();
+        if (stereo_job.valid())
+            stereo_job.get();
         if(!cur_pts.empty())
         {
             //printf("stereo image; track feature on right image\n");
-            vector<cv::Point2f> reverseLeftPts;
-            vector<uchar> status, statusRightLeft;
-            vector<float> err;
-            // cur left ---- cur right
-            cv::calcOpticalFlowPyrLK(cur_img, rightImg, cur_pts, cur_right_pts, status, err, cv::Size(21, 21), 3);
-            // reverse check cur right ---- cur left
-            if(FLOW_BACK)
+            vector<uchar> status;
+            if (parallel)
             {
-                cv::calcOpticalFlowPyrLK(rightImg, cur_img, cur_right_pts, reverseLeftPts, statusRightLeft, err, cv::Size(21, 21), 3);
-                for(size_t i = 0; i < status.size(); i++)
+                // 补做新点的双目匹配，再按cur_pts的顺序与已跟踪点的结果合并，保证与串行结果一致
+                size_t new_begin = cur_pts.size() - n_pts.size();
+                vector<cv::Point2f> new_left_pts(cur_pts.begin() + new_begin, cur_pts.end());
+                vector<cv::Point2f> new_right_pts;
+                vector<uchar> new_status;
+                stereoTrack(new_left_pts, new_right_pts, new_status, true);
+
+                map<int, int> stereo_index;
+                for (size_t i = 0; i < stereo_ids.size(); i++)
+                    stereo_index[stereo_ids[i]] = i;
+                cur_right_pts.resize(cur_pts.size());
+                status.resize(cur_pts.size());
+                for (size_t i = 0; i < cur_pts.size(); i++)
                 {
-                    if(status[i] && statusRightLeft[i] && inBorder(cur_right_pts[i]) && distance(cur_pts[i], reverseLeftPts[i]) <= 0.5)
-                        status[i] = 1;
+                    if (i >= new_begin)
+                    {
+                        cur_right_pts[i] = new_right_pts[i - new_begin];
+                        status[i] = new_status[i - new_begin];
+                    }
                     else
-                        status[i] = 0;
+                    {
+                        int j = stereo_index[ids[i]];
+                        cur_right_pts[i] = stereo_right_pts[j];
+                        status[i] = stereo_status[j];
+                    }
                 }
             }
+            else
+                stereoTrack(cur_pts, cur_right_pts, status, true);
 
             ids_right = ids;
             reduceVector(cur_right_pts, status);
@@ -580,6 +829,7 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
         // showUndistortion("undis");
     }
     prev_img = cur_img;
+    prev_pyr.swap(cur_pyr);  // 当前帧金字塔留作下一帧的prev，同时复用其内存
     prev_pts = cur_pts;
     prev_un_pts = cur_un_pts;
     prev_un_pts_map = cur_un_pts_map;
@@ -590,7 +840,8 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
     for(size_t i = 0; i < cur_pts.size(); i++)
         prevLeftPtsMap[ids[i]] = cur_pts[i];
 
-    map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> featureFrame;
+    frame.t = cur_time;
+    frame.reservePoints(ids.size() + ids_right.size());
     for (size_t i = 0; i < ids.size(); i++)
     {
         int feature_id = ids[i];
@@ -609,7 +860,7 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
         double depth = 0; 
         Eigen::Matrix<double, 8, 1> xyz_uv_velocity_depth;
         xyz_uv_velocity_depth << x, y, z, p_u, p_v, velocity_x, velocity_y, depth;
-        featureFrame[feature_id].emplace_back(camera_id,  xyz_uv_velocity_depth);
+        frame.addPoint(feature_id, camera_id, xyz_uv_velocity_depth);
     }
 
     if (!_img1.empty() && stereo_cam)
@@ -632,12 +883,11 @@ map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> FeatureTracker::trackIm
             double depth = 0; 
             Eigen::Matrix<double, 8, 1> xyz_uv_velocity_depth;
             xyz_uv_velocity_depth << x, y, z, p_u, p_v, velocity_x, velocity_y, depth;
-            featureFrame[feature_id].emplace_back(camera_id,  xyz_uv_velocity_depth);
+            frame.addPoint(feature_id, camera_id, xyz_uv_velocity_depth);
         }
     }
 
     //printf("feature track whole time %f\n", t_r.toc());
-    return featureFrame;
 }
 
 // 添加.边特征
@@ -740,6 +990,14 @@ void FeatureTracker::rejectWithF()
         for (unsigned int i = 0; i < cur_pts.size(); i++)
         {
             Eigen::Vector3d tmp_p;
+            if (!m_lut.empty())
+            {
+                m_lut[0]->liftProjective(Eigen::Vector2d(cur_pts[i].x, cur_pts[i].y), tmp_p);
+                un_cur_pts[i] = cv::Point2f(FOCAL_LENGTH * tmp_p.x() + col / 2.0, FOCAL_LENGTH * tmp_p.y() + row / 2.0);
+                m_lut[0]->liftProjective(Eigen::Vector2d(prev_pts[i].x, prev_pts[i].y), tmp_p);
+                un_prev_pts[i] = cv::Point2f(FOCAL_LENGTH * tmp_p.x() + col / 2.0, FOCAL_LENGTH * tmp_p.y() + row / 2.0);
+                continue;
+            }
             m_camera[0]->liftProjective(Eigen::Vector2d(cur_pts[i].x, cur_pts[i].y), tmp_p);
             tmp_p.x() = FOCAL_LENGTH * tmp_p.x() / tmp_p.z() + col / 2.0;
             tmp_p.y() = FOCAL_LENGTH * tmp_p.y() / tmp_p.z() + row / 2.0;
@@ -764,14 +1022,33 @@ void FeatureTracker::rejectWithF()
 
 void FeatureTracker::readIntrinsicParameter(const vector<string> &calib_file)
 {
-    for (size_t i = 0; i < calib_file.size(); i++)
+    // 重启时标定不变，前端线程还在读m_camera、m_lut，只在第一次读入时建
+    if (m_calib_file != calib_file)
     {
-        ROS_INFO("reading paramerter of camera %s", calib_file[i].c_str());
-        camodocal::CameraPtr camera = CameraFactory::instance()->generateCameraFromYamlFile(calib_file[i]); // 返回相机类型
-        m_camera.push_back(camera);
+        m_calib_file = calib_file;
+        for (size_t i = 0; i < calib_file.size(); i++)
+        {
+            ROS_INFO("reading paramerter of camera %s", calib_file[i].c_str());
+            camodocal::CameraPtr camera = CameraFactory::instance()->generateCameraFromYamlFile(calib_file[i]); // 返回相机类型
+            m_camera.push_back(camera);
+            if (UNDISTORT_LUT)
+            {
+                TicToc t_lut;
+                m_lut.push_back(camodocal::UndistortLUTPtr(new camodocal::UndistortLUT(camera)));
+                ROS_INFO("build undistortion table of camera %d: %f ms", (int)i, t_lut.toc());
+            }
+        }
     }
     if (calib_file.size() == 2)
         stereo_cam = 1;
+    if (!FISHEYE_MASK.empty() && fisheye_mask.empty())
+    {
+        fisheye_mask = cv::imread(FISHEYE_MASK, 0);
+        if (fisheye_mask.empty())
+            ROS_WARN("can not load fisheye mask %s", FISHEYE_MASK.c_str());
+    }
+    if (TRACK_THREADS > 1 && track_pool.size() != TRACK_THREADS)
+        track_pool.resize(TRACK_THREADS);
 }
 
 void FeatureTracker::showUndistortion(const string &name)
@@ -814,6 +1091,14 @@ void FeatureTracker::showUndistortion(const string &name)
 vector<cv::Point2f> FeatureTracker::undistortedPts(vector<cv::Point2f> &pts, camodocal::CameraPtr cam)
 {
     vector<cv::Point2f> un_pts;
+    for (size_t i = 0; i < m_lut.size(); i++)
+    {
+        if (m_camera[i] == cam)
+        {
+            m_lut[i]->liftNormalized(pts, un_pts);
+            return un_pts;
+        }
+    }
     for (unsigned int i = 0; i < pts.size(); i++)
     {
         Eigen::Vector2d a(pts[i].x, pts[i].y);
@@ -24,8 +24,11 @@
 #include "camodocal/camera_models/CameraFactory.h"
 #include "camodocal/camera_models/CataCamera.h"
 #include "camodocal/camera_models/PinholeCamera.h"
+#include "camodocal/camera_models/UndistortLUT.h"
 #include "../estimator/parameters.h"
+#include "../estimator/feature_frame.h"
 #include "../utility/tic_toc.h"
+#include "../utility/thread_pool.h"
 #include "linefeature_tracker.h"
 
 
@@ -42,7 +45,7 @@ class FeatureTracker
 public:
     FeatureTracker();
     
-    map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1 = cv::Mat());
+    void trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1, FeatureFrame &frame);
     vector<pair<double, cv::Point2f>> transPtsType(vector<cv::Point2f> &pts);
 
     map<int, vector<pair<int, Eigen::Matrix<double, 8, 1>>>> trackLImage(double _cur_time, const cv::Mat &_img,  
@@ -58,6 +61,17 @@ public:
     
     
     void setMask();
+    void setGrid();
+    int gridIndex(const cv::Point2f &pt);
+    bool gridFree(const cv::Point2f &pt);
+    void gridInsert(const cv::Point2f &pt);
+    void detectGrid(int n_max_cnt, vector<cv::Point2f> &pts);
+    void buildPyramid(const cv::Mat &img, vector<cv::Mat> &pyr);
+    void trackPyrLK(const vector<cv::Mat> &pyr0, const vector<cv::Mat> &pyr1,
+                    const vector<cv::Point2f> &pts0, vector<cv::Point2f> &pts1,
+                    vector<uchar> &status, int max_level, bool use_initial_flow, bool split = true);
+    void stereoTrack(const vector<cv::Point2f> &left_pts, vector<cv::Point2f> &right_pts,
+                     vector<uchar> &status, bool split);
     void readIntrinsicParameter(const vector<string> &calib_file);
     void showUndistortion(const string &name);
     void ExtractEdgeFeature(std::vector<cv::Point2f> &total_pts, int NeedNum);
@@ -75,7 +89,7 @@ public:
                                    vector<cv::Point2f> &curRightPts,
                                    map<int, cv::Point2f> &prevLeftPtsMap);
     void setPrediction(map<int, Eigen::Vector3d> &predictPts);
-    double distance(cv::Point2f &pt1, cv::Point2f &pt2);
+    double distance(const cv::Point2f &pt1, const cv::Point2f &pt2);
     void removeOutliers(set<int> &removePtsIds);
     cv::Mat getTrackImage();
     bool inBorder(const cv::Point2f &pt);
@@ -83,8 +97,15 @@ public:
     int row, col;
     cv::Mat imTrack;
     cv::Mat mask;
-    cv::Mat fisheye_mask;
+    int grid_size, grid_cols, grid_rows;  // grid_detect模式下的栅格，边长MIN_DIST
+    vector<int> grid_head;                // 每格第一个点在grid_pts中的下标，-1为空
+    vector<int> grid_next;                // 同一格中下一个点的下标
+    vector<cv::Point2f> grid_pts;
+    cv::Mat fisheye_mask;                 // 为空时不使用
     cv::Mat prev_img, cur_img;
+    cv::Ptr<cv::CLAHE> clahe;
+    cv::Mat equalize_img[2];  // 左右目直方图均衡化的输出缓冲区，逐帧复用
+    vector<cv::Mat> prev_pyr, cur_pyr, right_pyr;  // 每帧只构建一次的光流金字塔，cur_pyr在帧末转为prev_pyr
     vector<cv::Point2f> n_pts;
     vector<cv::Point2f> predict_pts;
     vector<cv::Point2f> predict_pts_debug;
@@ -97,11 +118,14 @@ public:
     map<int, cv::Point2f> cur_un_right_pts_map, prev_un_right_pts_map;
     map<int, cv::Point2f> prevLeftPtsMap;
     vector<camodocal::CameraPtr> m_camera;
+    vector<camodocal::UndistortLUTPtr> m_lut;  // undistort_lut开启时与m_camera一一对应
+    vector<string> m_calib_file;               // m_camera、m_lut对应的标定文件
     double cur_time;
     double prev_time;
     bool stereo_cam;
     int n_id;
     bool hasPrediction;
+    ThreadPool track_pool;  // track_threads > 1 时启用的光流线程池
 
 
     //修改的原特征点数据结构
@@ -0,0 +1,211 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#include "line_detector.h"
+
+#include <algorithm>
+#include <ros/console.h>
+#include <opencv2/opencv_modules.hpp>
+#ifdef HAVE_OPENCV_XIMGPROC
+#include <opencv2/ximgproc.hpp>
+#endif
+
+using cv::line_descriptor::KeyLine;
+
+static const int LINE_TILE_OVERLAP = 16;          // 相邻块的重叠宽度(像素)
+static const float LINE_TILE_MERGE_GAP = 5.0;     // 块边界处合并时两段之间的最大空隙(像素)
+static const float LINE_MERGE_DIST = 2.0;         // 合并时端点到另一条线的最大距离(像素)
+static const float LINE_MERGE_ANGLE = 2.0 * M_PI / 180.0;
+
+LineDetectorPtr LineDetector::create(int type, int tiles)
+{
+    if (tiles > 1)
+        return std::make_shared<TiledLineDetector>(type, tiles);
+    if (type == LINE_DETECTOR_FLD)
+    {
+#ifdef HAVE_OPENCV_XIMGPROC
+        return std::make_shared<FLDLineDetector>(10);
+#else
+        ROS_WARN("opencv is built without ximgproc, FLD is not available, use LSD");
+#endif
+    }
+    return std::make_shared<LSDLineDetector>();
+}
+
+LSDLineDetector::LSDLineDetector()
+{
+    lsd_ = cv::line_descriptor::LSDDetector::createLSDDetector();
+}
+
+void LSDLineDetector::detect(const cv::Mat &img, std::vector<KeyLine> &lines)
+{
+    lines.clear();
+    lsd_->detect(img, lines, 2, 1);   // 只保留第0层的线，不再构建第二层金字塔
+}
+
+FLDLineDetector::FLDLineDetector(float min_length)
+{
+#ifdef HAVE_OPENCV_XIMGPROC
+    // 不在FLD里合并线段，和LSD的输出保持一致
+    fld_ = cv::ximgproc::createFastLineDetector(min_length, 1.414213562f, 50, 50, 3, false);
+#endif
+}
+
+void FLDLineDetector::detect(const cv::Mat &img, std::vector<KeyLine> &lines)
+{
+    lines.clear();
+#ifdef HAVE_OPENCV_XIMGPROC
+    std::vector<cv::Vec4f> segments;
+    fld_.dynamicCast<cv::ximgproc::FastLineDetector>()->detect(img, segments);
+    lines.reserve(segments.size());
+    for (size_t i = 0; i < segments.size(); i++)
+        lines.push_back(makeKeyLine(segments[i], img.size(), i));
+#endif
+}
+
+TiledLineDetector::TiledLineDetector(int type, int tiles)
+    : tiles_(tiles)
+{
+    for (int i = 0; i < tiles * tiles; i++)
+        detectors_.push_back(LineDetector::create(type));
+    // 调用线程自己也检测一块
+    int threads = std::min<int>(tiles * tiles, std::max(1u, std::thread::hardware_concurrency()));
+    pool_.resize(threads - 1);
+}
+
+void TiledLineDetector::detect(const cv::Mat &img, std::vector<KeyLine> &lines)
+{
+    int n = tiles_ * tiles_;
+    std::vector<std::vector<KeyLine>> tile_lines(n);
+    auto detectTile = [&](int k)
+    {
+        int r = k / tiles_, c = k % tiles_;
+        int x0 = std::max(img.cols * c / tiles_ - LINE_TILE_OVERLAP / 2, 0);
+        int x1 = std::min(img.cols * (c + 1) / tiles_ + LINE_TILE_OVERLAP / 2, img.cols);
+        int y0 = std::max(img.rows * r / tiles_ - LINE_TILE_OVERLAP / 2, 0);
+        int y1 = std::min(img.rows * (r + 1) / tiles_ + LINE_TILE_OVERLAP / 2, img.rows);
+        detectors_[k]->detect(img(cv::Rect(x0, y0, x1 - x0, y1 - y0)), tile_lines[k]);
+        for (KeyLine &kl : tile_lines[k])   // 平移回整图坐标
+        {
+            kl = makeKeyLine(cv::Vec4f(kl.startPointX + x0, kl.startPointY + y0, kl.endPointX + x0, kl.endPointY + y0),
+                             img.size(), 0);
+        }
+    };
+
+    std::vector<std::future<void>> jobs;
+    for (int k = 0; k < n - 1; k++)
+        jobs.push_back(pool_.enqueue([&detectTile, k]() { detectTile(k); }));
+    detectTile(n - 1);
+    for (auto &job : jobs)
+        job.get();
+
+    lines.clear();
+    for (auto &tl : tile_lines)
+        lines.insert(lines.end(), tl.begin(), tl.end());
+    mergeBorderLines(img.size(), lines);
+    for (size_t i = 0; i < lines.size(); i++)
+        lines[i].class_id = i;
+}
+
+// b的两个端点都在a所在直线附近、方向一致，且两段之间的空隙不超过max_gap时，把b并到a上(沿a的方向取并集)
+static bool mergeCollinear(KeyLine &a, const KeyLine &b, const cv::Size &size, float max_gap)
+{
+    cv::Point2f a0 = a.getStartPoint(), d = a.getEndPoint() - a0;
+    float la = cv::norm(d);
+    cv::Point2f db = b.getEndPoint() - b.getStartPoint();
+    if (la < 1e-3 || std::fabs(d.dot(db)) < std::cos(LINE_MERGE_ANGLE) * la * cv::norm(db))
+        return false;
+    d *= 1.0f / la;
+    cv::Point2f q0 = b.getStartPoint() - a0, q1 = b.getEndPoint() - a0;
+    if (std::fabs(q0.cross(d)) > LINE_MERGE_DIST || std::fabs(q1.cross(d)) > LINE_MERGE_DIST)
+        return false;
+    float t0 = std::min(q0.dot(d), q1.dot(d)), t1 = std::max(q0.dot(d), q1.dot(d));
+    if (t0 > la + max_gap || t1 < -max_gap)
+        return false;
+    cv::Point2f s = a0 + std::min(0.0f, t0) * d, e = a0 + std::max(la, t1) * d;
+    a = makeKeyLine(cv::Vec4f(s.x, s.y, e.x, e.y), size, a.class_id);
+    return true;
+}
+
+void TiledLineDetector::mergeBorderLines(const cv::Size &size, std::vector<KeyLine> &lines)
+{
+    // 只有端点靠近块边界的线段可能被截断或重复检测
+    auto nearBorder = [&](const cv::Point2f &p)
+    {
+        for (int k = 1; k < tiles_; k++)
+        {
+            if (std::fabs(p.x - size.width * k / tiles_) < LINE_TILE_OVERLAP ||
+                std::fabs(p.y - size.height * k / tiles_) < LINE_TILE_OVERLAP)
+                return true;
+        }
+        return false;
+    };
+
+    std::vector<KeyLine> merged, border;
+    for (const KeyLine &kl : lines)
+    {
+        if (nearBorder(kl.getStartPoint()) || nearBorder(kl.getEndPoint()))
+            border.push_back(kl);
+        else
+            merged.push_back(kl);
+    }
+    mergeCollinearLines(border, size, LINE_TILE_MERGE_GAP);
+    merged.insert(merged.end(), border.begin(), border.end());
+    lines.swap(merged);
+}
+
+void mergeCollinearLines(std::vector<KeyLine> &lines, const cv::Size &size, float max_gap)
+{
+    // 长的线段优先作为合并的基准
+    std::sort(lines.begin(), lines.end(), [](const KeyLine &a, const KeyLine &b) { return a.lineLength > b.lineLength; });
+
+    std::vector<KeyLine> merged;
+    std::vector<bool> used(lines.size(), false);
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        if (used[i])
+            continue;
+        KeyLine kl = lines[i];
+        bool grown = true;
+        while (grown)   // 合并后线段变长，可能又能接上别的线段
+        {
+            grown = false;
+            for (size_t j = i + 1; j < lines.size(); j++)
+            {
+                if (!used[j] && mergeCollinear(kl, lines[j], size, max_gap))
+                {
+                    used[j] = true;
+                    grown = true;
+                }
+            }
+        }
+        merged.push_back(kl);
+    }
+    lines.swap(merged);
+}
+
+KeyLine makeKeyLine(const cv::Vec4f &segment, const cv::Size &image_size, int class_id)
+{
+    KeyLine kl;
+    kl.startPointX = kl.sPointInOctaveX = segment[0];
+    kl.startPointY = kl.sPointInOctaveY = segment[1];
+    kl.endPointX = kl.ePointInOctaveX = segment[2];
+    kl.endPointY = kl.ePointInOctaveY = segment[3];
+
+    float dx = segment[2] - segment[0], dy = segment[3] - segment[1];
+    kl.lineLength = std::sqrt(dx * dx + dy * dy);
+    kl.angle = std::atan2(dy, dx);
+    kl.pt = cv::Point2f(0.5f * (segment[0] + segment[2]), 0.5f * (segment[1] + segment[3]));
+    kl.size = std::fabs(dx * dy);
+    kl.response = kl.lineLength / std::max(image_size.width, image_size.height);
+    kl.numOfPixels = std::max(std::fabs(dx), std::fabs(dy)) + 1;
+    kl.octave = 0;
+    kl.class_id = class_id;
+    return kl;
+}
@@ -0,0 +1,90 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/line_descriptor.hpp>
+
+#include "../utility/thread_pool.h"
+
+enum LineDetectorType
+{
+    LINE_DETECTOR_LSD = 0,
+    LINE_DETECTOR_FLD = 1
+};
+
+/**
+ * 线段检测接口，输出第0层的KeyLine，可以直接交给LBD计算描述子。
+ * 长度、直线度等筛选由调用者做
+ */
+class LineDetector
+{
+  public:
+    virtual ~LineDetector() {}
+    virtual void detect(const cv::Mat &img, std::vector<cv::line_descriptor::KeyLine> &lines) = 0;
+    virtual std::string name() const = 0;
+
+    // 按配置里的line_detector创建，不支持的类型退回LSD；tiles > 1时分块并行检测
+    static std::shared_ptr<LineDetector> create(int type, int tiles = 1);
+};
+typedef std::shared_ptr<LineDetector> LineDetectorPtr;
+
+// 单尺度LSD(opencv line_descriptor)
+class LSDLineDetector : public LineDetector
+{
+  public:
+    LSDLineDetector();
+    void detect(const cv::Mat &img, std::vector<cv::line_descriptor::KeyLine> &lines);
+    std::string name() const { return "LSD"; }
+
+  private:
+    cv::Ptr<cv::line_descriptor::LSDDetector> lsd_;
+};
+
+// FLD(opencv ximgproc FastLineDetector)：Canny边缘上拟合线段，比LSD快数倍
+class FLDLineDetector : public LineDetector
+{
+  public:
+    FLDLineDetector(float min_length);
+    void detect(const cv::Mat &img, std::vector<cv::line_descriptor::KeyLine> &lines);
+    std::string name() const { return "FLD"; }
+
+  private:
+    cv::Ptr<cv::Algorithm> fld_;
+};
+
+/**
+ * 分块并行检测：图像切成tiles x tiles块，相邻块重叠LINE_TILE_OVERLAP像素，每块用自己的检测器对象。
+ * 块边界附近被截断的线段和重叠区里重复检测的线段再合并回一条，结果接近整图检测
+ */
+class TiledLineDetector : public LineDetector
+{
+  public:
+    TiledLineDetector(int type, int tiles);
+    void detect(const cv::Mat &img, std::vector<cv::line_descriptor::KeyLine> &lines);
+    std::string name() const { return detectors_[0]->name() + "x" + std::to_string(tiles_ * tiles_); }
+
+  private:
+    void mergeBorderLines(const cv::Size &size, std::vector<cv::line_descriptor::KeyLine> &lines);
+
+    int tiles_;
+    std::vector<LineDetectorPtr> detectors_;
+    ThreadPool pool_;
+};
+
+// 图像上的线段(起点x, y, 终点x, y)转成第0层的KeyLine
+cv::line_descriptor::KeyLine makeKeyLine(const cv::Vec4f &segment, const cv::Size &image_size, int class_id);
+
+// 把共线且相互重叠或空隙不超过max_gap像素的线段合并成一条，合并后按长度从长到短排列
+void mergeCollinearLines(std::vector<cv::line_descriptor::KeyLine> &lines, const cv::Size &size, float max_gap);
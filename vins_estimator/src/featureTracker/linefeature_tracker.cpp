@@ -5,16 +5,40 @@ LineFeatureTracker::LineFeatureTracker()
 {
     allfeature_cnt = 0;
     frame_cnt = 0;
+    detect_request = false;
+    hasPrediction = false;
     sum_time = 0.0;
+    cur_time = 0.0;
+    last_vis_time = -1e9;
+
+    // 检测、描述、匹配和均衡化的对象逐帧复用；检测器要按配置建，留给setParameter
+    bd_ = BinaryDescriptor::createBinaryDescriptor();
+    bdm_ = BinaryDescriptorMatcher::createBinaryDescriptorMatcher();
+    clahe_ = cv::createCLAHE(3.0, cv::Size(8, 8));
 }
 
-void LineFeatureTracker::readIntrinsicParameter(const string &calib_file)
+void LineFeatureTracker::readIntrinsicParameter(const vector<string> &calib_file)
 {
-    ROS_INFO("reading paramerter of camera %s", calib_file.c_str());
+    // 重启时标定不变，线程池里可能正在用内参、去畸变表，只在第一次读入时建
+    if (m_calib_file == calib_file)
+        return;
+    m_calib_file = calib_file;
+    ROS_INFO("reading paramerter of camera %s", calib_file[0].c_str());
 
-    m_camera = CameraFactory::instance()->generateCameraFromYamlFile(calib_file);
+    m_camera = CameraFactory::instance()->generateCameraFromYamlFile(calib_file[0]);
     K_ = m_camera->initUndistortRectifyMap(undist_map1_, undist_map2_);  
+    if (UNDISTORT_LUT)
+        m_lut.reset(new camodocal::UndistortLUT(m_camera));
     // m_camera->initUndistortMap(undist_map1_, undist_map2_, 1.0); 
+
+    if (STEREO_LINE && calib_file.size() > 1)   // 左右目线匹配需要右目内参
+    {
+        ROS_INFO("reading paramerter of camera %s", calib_file[1].c_str());
+        m_camera_right = CameraFactory::instance()->generateCameraFromYamlFile(calib_file[1]);
+        K_right_ = m_camera_right->initUndistortRectifyMap(undist_map1_right_, undist_map2_right_);
+        if (UNDISTORT_LUT)
+            m_lut_right.reset(new camodocal::UndistortLUT(m_camera_right));
+    }
 }
 
 vector<Line> LineFeatureTracker::undistortedLineEndPoints()
@@ -49,8 +73,16 @@ vector<Line> LineFeatureTracker::undistortedLineEndPointsMei(camodocal::CameraPt
         Eigen::Vector2d End(curframe_->vecLine[i].EndPt.x, curframe_->vecLine[i].EndPt.y);
         Eigen::Vector3d unStart, unEnd;
 
-        cam->liftSphere(Start, unStart);
-        cam->liftSphere(End, unEnd);
+        if (m_lut && cam == m_camera)
+        {
+            m_lut->liftProjective(Start, unStart);
+            m_lut->liftProjective(End, unEnd);
+        }
+        else
+        {
+            cam->liftSphere(Start, unStart);
+            cam->liftSphere(End, unEnd);
+        }
 
         un_lines[i].StartPt.x = unStart.x() / unStart.z();
         un_lines[i].StartPt.y = unStart.y() / unStart.z();
@@ -258,10 +290,10 @@ void LineFeatureTracker::readImage(const cv::Mat &_img)
 #endif
 
 #define MATCHES_DIST_THRESHOLD 30
-void visualize_line_match(Mat imageMat1, Mat imageMat2,
-                          std::vector<KeyLine> octave0_1, std::vector<KeyLine>octave0_2,
-                          std::vector<DMatch> good_matches,
-                          std::vector<DMatch> lsd_matches)
+// 画出前后帧线特征的匹配，由showLineMatch在调试线程中调用
+static cv::Mat drawLineMatch(const Mat &imageMat1, const Mat &imageMat2,
+                             const std::vector<KeyLine> &octave0_1, const std::vector<KeyLine> &octave0_2,
+                             const std::vector<DMatch> &good_matches)
 {
     //	Mat img_1;
     cv::Mat img1,img2;
@@ -309,86 +341,603 @@ void visualize_line_match(Mat imageMat1, Mat imageMat2,
     }
     /* plot matches */
     cv::Mat lsd_outImg;
-    std::vector<char> lsd_mask( lsd_matches.size(), 1 );
+    std::vector<char> lsd_mask( good_matches.size(), 1 );
     drawLineMatches( img1, octave0_1, img2, octave0_2, good_matches, lsd_outImg, cv::Scalar(0, 255, 0), cv::Scalar(0, 0, 255), lsd_mask,
     DrawLinesMatchesFlags::DEFAULT );
-    imshow( "LSD matches", lsd_outImg );
+    return lsd_outImg;
+}
 
-    imshow("LSD matches1", img1);
+void LineFeatureTracker::setMatchImageCallback(const std::function<void(const cv::Mat &, double)> &callback)
+{
+    if (vis_pool.size() > 0)   // 只装一次：重启时线程上可能正在读回调、往池里放任务
+        return;
+    match_image_callback = callback;
+    vis_pool.resize(1);
+}
 
-    // imshow("LSD matches2", img2);
-    waitKey(1);
+/**
+ * 按SHOW_LINE_TRACK限制频率，把匹配结果交给调试线程绘制并发布；上一张还没画完时直接跳过
+ */
+void LineFeatureTracker::showLineMatch(const std::vector<DMatch> &good_matches)
+{
+    if (!match_image_callback || cur_time - last_vis_time < 1.0 / SHOW_LINE_TRACK)
+        return;
+    if (vis_job.valid() && vis_job.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    last_vis_time = cur_time;
+
+    // 图像只读，共享内存即可；线段在本帧后面会被重排，拷贝一份
+    cv::Mat img1 = forwframe_->img, img2 = curframe_->img;
+    std::vector<KeyLine> lines1 = forwframe_->keylsd, lines2 = curframe_->keylsd;
+    double t = cur_time;
+    auto callback = match_image_callback;
+    vis_job = vis_pool.enqueue([=]()
+    {
+        callback(drawLineMatch(img1, img2, lines1, lines2, good_matches), t);
+    });
 }
 
-void visualize_line_match(Mat imageMat1, Mat imageMat2,
-                          std::vector<KeyLine> octave0_1, std::vector<KeyLine>octave0_2,
-                          std::vector<bool> good_matches,
-                          std::vector<DMatch> lsd_matches)
+Eigen::Vector2d LineFeatureTracker::liftNormalized(const cv::Point2f &p, int cam)
 {
-    //	Mat img_1;
-    cv::Mat img1,img2;
-    if (imageMat1.channels() != 3){
-        cv::cvtColor(imageMat1, img1, cv::COLOR_GRAY2BGR);
+    const camodocal::UndistortLUTPtr &lut = cam == 0 ? m_lut : m_lut_right;
+    Eigen::Vector2d xy;
+    if (lut)
+        lut->liftNormalized(Eigen::Vector2d(p.x, p.y), xy);
+    else
+    {
+        Eigen::Vector3d P;
+        (cam == 0 ? m_camera : m_camera_right)->liftSphere(Eigen::Vector2d(p.x, p.y), P);
+        xy = P.head<2>() / P.z();
     }
-    else{
-        img1 = imageMat1;
+    return xy;
+}
+
+// 线段端点转到归一化平面，remap模式下用remap后的针孔内参
+Eigen::Vector4d LineFeatureTracker::normalizeLine(const KeyLine &kl, int cam)
+{
+    cv::Point2f sp = kl.getStartPoint(), ep = kl.getEndPoint();
+    if (LINE_ENDPOINT_UNDISTORT)
+    {
+        Eigen::Vector2d s = liftNormalized(sp, cam), e = liftNormalized(ep, cam);
+        return Eigen::Vector4d(s.x(), s.y(), e.x(), e.y());
     }
+    const cv::Mat &K = cam == 0 ? K_ : K_right_;
+    float fx = K.at<float>(0, 0), fy = K.at<float>(1, 1);
+    float cx = K.at<float>(0, 2), cy = K.at<float>(1, 2);
+    return Eigen::Vector4d((sp.x - cx) / fx, (sp.y - cy) / fy, (ep.x - cx) / fx, (ep.y - cy) / fy);
+}
 
-    if (imageMat2.channels() != 3){
-        cv::cvtColor(imageMat2, img2, cv::COLOR_GRAY2BGR);
+/**
+ * 原图上检测的线段去畸变后不一定还是直线：在端点之间取LINE_MID_SAMPLES个点，
+ * 去畸变后到端点连线的距离超过LINE_STRAIGHT_THRESHOLD像素就丢掉。remap模式下不需要检查
+ */
+bool LineFeatureTracker::isStraight(const KeyLine &kl, int cam)
+{
+    if (!LINE_ENDPOINT_UNDISTORT || LINE_MID_SAMPLES <= 0)
+        return true;
+    cv::Point2f sp = kl.getStartPoint(), ep = kl.getEndPoint();
+    Eigen::Vector2d s = liftNormalized(sp, cam), e = liftNormalized(ep, cam);
+    Eigen::Vector2d dir = e - s;
+    double len = dir.norm();
+    if (len < 1e-9)
+        return false;
+    dir /= len;
+    for (int k = 1; k <= LINE_MID_SAMPLES; k++)
+    {
+        float r = float(k) / (LINE_MID_SAMPLES + 1);
+        Eigen::Vector2d m = liftNormalized(sp + r * (ep - sp), cam) - s;
+        double dist = fabs(m.x() * dir.y() - m.y() * dir.x());
+        if (dist * FOCAL_LENGTH > LINE_STRAIGHT_THRESHOLD)
+            return false;
     }
-    else{
-        img2 = imageMat2;
+    return true;
+}
+
+/**
+ * 单尺度线段检测(LSD/FLD)，先按长度筛掉短线，只对留下的线计算LBD描述子
+ */
+void LineFeatureTracker::extractLines(const cv::Mat &img, std::vector<KeyLine> &keylsd, cv::Mat &keylbd_descr, int cam)
+{
+    TicToc t_li;
+    std::vector<KeyLine> lsd;
+    detector_->detect( img, lsd );
+    if (MAX_LINE_CNT > 0)   // 一条边缘常被断成几段，先合并再筛选
+        mergeCollinearLines(lsd, img.size(), LINE_FRAGMENT_GAP);
+
+    keylsd.clear();
+    keylsd.reserve(lsd.size());
+    for ( int i = 0; i < (int) lsd.size(); i++ )
+    {
+        if( lsd[i].lineLength >= LINE_MIN_LENGTH && isStraight(lsd[i], cam) )
+        {
+            keylsd.push_back( lsd[i] );
+            keylsd.back().class_id = keylsd.size() - 1;   // LBD按class_id组织线段，筛选后重新编号
+        }
     }
+    sum_time += t_li.toc();
 
-    //    srand(time(NULL));
-    int lowest = 0, highest = 255;
-    int range = (highest - lowest) + 1;
-    for (int k = 0; k < good_matches.size(); ++k) {
+    TicToc t_lbd;
+    if (keylsd.empty())
+        keylbd_descr.release();
+    else
+        bd_->compute( img, keylsd, keylbd_descr );
+    sum_time += t_lbd.toc();
+}
 
-        if(!good_matches[k]) continue;
+// 相机坐标系下的点投影到检测线特征的图像上(remap后的针孔图像或原图)
+cv::Point2f LineFeatureTracker::projectToImage(const Eigen::Vector3d &pts_cam)
+{
+    if (LINE_ENDPOINT_UNDISTORT)
+    {
+        Eigen::Vector2d uv;
+        m_camera->spaceToPlane(pts_cam, uv);
+        return cv::Point2f(uv.x(), uv.y());
+    }
+    return cv::Point2f(K_.at<float>(0, 0) * pts_cam.x() / pts_cam.z() + K_.at<float>(0, 2),
+                       K_.at<float>(1, 1) * pts_cam.y() / pts_cam.z() + K_.at<float>(1, 2));
+}
 
-        KeyLine line1 = octave0_1[k];  // trainIdx
-        KeyLine line2 = octave0_2[k];  //queryIdx
+/**
+ * 后端给出的已三角化线段端点(当前帧相机坐标系)，投影后作为匹配时的预测位置
+ */
+void LineFeatureTracker::setPrediction(const map<int, pair<Eigen::Vector3d, Eigen::Vector3d>> &predictLines)
+{
+    hasPrediction = true;
+    predict_lines.clear();
+    for (auto &it : predictLines)
+        predict_lines[it.first] = make_pair(projectToImage(it.second.first), projectToImage(it.second.second));
+}
 
-        unsigned int r = lowest + int(rand() % range);
-        unsigned int g = lowest + int(rand() % range);
-        unsigned int b = lowest + int(rand() % range);
-        cv::Point startPoint = cv::Point(int(line1.startPointX), int(line1.startPointY));
-        cv::Point endPoint = cv::Point(int(line1.endPointX), int(line1.endPointY));
-        // cv::line(img1, startPoint, endPoint, cv::Scalar(r, g, b),2 ,8);
-        cv::line(img1, startPoint, endPoint, cv::Scalar(0, 0, 255),2 ,8);
+/**
+ * 门限匹配：上一帧的线按预测位置(没有预测时用上一帧的位置)的中点放进网格，
+ * 新检测的线只和附近格子里端点距离在门限内的线比较描述子
+ */
+void LineFeatureTracker::matchLinesGated(std::vector<DMatch> &good_matches)
+{
+    const float cell = LINE_MATCH_GATE;
+    int grid_cols = forwframe_->img.cols / cell + 1;
+    int grid_rows = forwframe_->img.rows / cell + 1;
+    vector<vector<int>> grid(grid_cols * grid_rows);
+
+    size_t n_cur = curframe_->keylsd.size();
+    vector<Point2f> exp_s(n_cur), exp_e(n_cur);
+    vector<float> gate(n_cur);
+    for (size_t j = 0; j < n_cur; j++)
+    {
+        auto it = hasPrediction ? predict_lines.find(curframe_->lineID[j]) : predict_lines.end();
+        if (it != predict_lines.end())
+        {
+            exp_s[j] = it->second.first;
+            exp_e[j] = it->second.second;
+            gate[j] = LINE_PREDICT_GATE;
+        }
+        else
+        {
+            exp_s[j] = curframe_->keylsd[j].getStartPoint();
+            exp_e[j] = curframe_->keylsd[j].getEndPoint();
+            gate[j] = LINE_MATCH_GATE;
+        }
+        Point2f mid = 0.5f * (exp_s[j] + exp_e[j]);
+        int gx = mid.x / cell, gy = mid.y / cell;
+        if (gx >= 0 && gy >= 0 && gx < grid_cols && gy < grid_rows)
+            grid[gy * grid_cols + gx].push_back(j);
+    }
 
-        cv::Point startPoint2 = cv::Point(int(line2.startPointX), int(line2.startPointY));
-        cv::Point endPoint2 = cv::Point(int(line2.endPointX), int(line2.endPointY));
-        // cv::line(img2, startPoint2, endPoint2, cv::Scalar(r, g, b),2, 8);
-        cv::line(img2, startPoint2, endPoint2, cv::Scalar(0, 0, 255),2, 8);
-        cv::line(img2, startPoint, startPoint2, cv::Scalar(0, 0, 255),1, 8);
-        cv::line(img2, endPoint, endPoint2, cv::Scalar(0, 0, 255),1, 8);
+    for (size_t i = 0; i < forwframe_->keylsd.size(); i++)
+    {
+        const KeyLine &kl = forwframe_->keylsd[i];
+        Point2f sp = kl.getStartPoint(), ep = kl.getEndPoint();
+        Point2f mid = 0.5f * (sp + ep);
+        int gx = mid.x / cell, gy = mid.y / cell;
+
+        int best_j = -1;
+        double best_dist = MATCHES_DIST_THRESHOLD;
+        for (int y = max(gy - 1, 0); y <= min(gy + 1, grid_rows - 1); y++)
+            for (int x = max(gx - 1, 0); x <= min(gx + 1, grid_cols - 1); x++)
+                for (int j : grid[y * grid_cols + x])
+                {
+                    Point2f serr = sp - exp_s[j], eerr = ep - exp_e[j];
+                    float g2 = gate[j] * gate[j];
+                    if (serr.dot(serr) >= g2 || eerr.dot(eerr) >= g2)
+                        continue;
+                    double dist = cv::norm(forwframe_->lbd_descr.row(i), curframe_->lbd_descr.row(j), NORM_HAMMING);
+                    if (dist < best_dist)
+                    {
+                        best_dist = dist;
+                        best_j = j;
+                    }
+                }
+        if (best_j >= 0)
+            good_matches.push_back(DMatch(i, best_j, best_dist));
+    }
+}
 
+/**
+ * 右目上检测线段，和当前帧(左目)保留下来的线按描述子匹配；夹角和竖直方向的范围对得上才算同一条线。
+ * 右目观测用左目线段的id、相机号1加入frame，端点方向和左目保持一致
+ */
+void LineFeatureTracker::matchStereoLines(const cv::Mat &_img1, FeatureFrame &frame)
+{
+    if (!m_camera_right || curframe_->keylsd.empty())
+        return;
+
+    cv::Mat img1;   // 右目图像不保存到帧里，不需要拷贝
+    if (LINE_ENDPOINT_UNDISTORT)
+    {
+        if (EQUALIZE)
+            clahe_->apply(_img1, img1);
+        else
+            img1 = _img1;
     }
-    /* plot matches */
-    /*
-    cv::Mat lsd_outImg;
-    std::vector<char> lsd_mask( lsd_matches.size(), 1 );
-    drawLineMatches( imageMat1, octave0_1, imageMat2, octave0_2, good_matches, lsd_outImg, Scalar::all( -1 ), Scalar::all( -1 ), lsd_mask,
-    DrawLinesMatchesFlags::DEFAULT );
+    else
+    {
+        cv::remap(_img1, img1, undist_map1_right_, undist_map2_right_, CV_INTER_LINEAR);
+        if (EQUALIZE)
+            clahe_->apply(img1, img1);
+    }
+
+    std::vector<KeyLine> keylsd_right;
+    Mat lbd_descr_right;
+    extractLines(img1, keylsd_right, lbd_descr_right, 1);
+    if (keylsd_right.empty())
+        return;
+
+    TicToc t_match;
+    std::vector<DMatch> lsd_matches;
+    bdm_->match(curframe_->lbd_descr, lbd_descr_right, lsd_matches);
+
+    // 每条右目线段只留描述子距离最近的左目线段
+    vector<int> best_left(keylsd_right.size(), -1);
+    vector<float> best_dist(keylsd_right.size(), MATCHES_DIST_THRESHOLD);
+    const float min_cos = cos(LINE_STEREO_MAX_ANGLE);
+    for (const DMatch &mt : lsd_matches)
+    {
+        if (mt.distance >= best_dist[mt.trainIdx])
+            continue;
+        const KeyLine &kl = curframe_->keylsd[mt.queryIdx];
+        const KeyLine &kr = keylsd_right[mt.trainIdx];
+        Point2f dl = kl.getEndPoint() - kl.getStartPoint();
+        Point2f dr = kr.getEndPoint() - kr.getStartPoint();
+        if (fabs(dl.dot(dr)) < min_cos * cv::norm(dl) * cv::norm(dr))
+            continue;
+        float overlap = min(max(kl.startPointY, kl.endPointY), max(kr.startPointY, kr.endPointY))
+                      - max(min(kl.startPointY, kl.endPointY), min(kr.startPointY, kr.endPointY));
+        if (overlap < -LINE_STEREO_GATE_Y)
+            continue;
+        best_left[mt.trainIdx] = mt.queryIdx;
+        best_dist[mt.trainIdx] = mt.distance;
+    }
+    sum_time += t_match.toc();
+
+    for (size_t j = 0; j < keylsd_right.size(); j++)
+    {
+        int i = best_left[j];
+        if (i < 0)
+            continue;
+        KeyLine kr = keylsd_right[j];
+        const KeyLine &kl = curframe_->keylsd[i];
+        if ((kl.getEndPoint() - kl.getStartPoint()).dot(kr.getEndPoint() - kr.getStartPoint()) < 0)
+        {
+            std::swap(kr.startPointX, kr.endPointX);
+            std::swap(kr.startPointY, kr.endPointY);
+        }
+        frame.addLine(curframe_->lineID[i], 1, normalizeLine(kr, 1));
+    }
+}
+
+void LineFeatureTracker::requestDetection()
+{
+    detect_request = true;
+}
+
+static bool inImage(const cv::Mat &img, const Point2f &pt)
+{
+    const int BORDER_SIZE = 1;
+    return BORDER_SIZE <= pt.x && pt.x < img.cols - BORDER_SIZE && BORDER_SIZE <= pt.y && pt.y < img.rows - BORDER_SIZE;
+}
+
+/**
+ * 跟踪上的采样点重新拟合直线。采样点在原线段上的比例s和它在新直线上的位置t线性回归，
+ * 外推到s=0,1得到端点，端点丢了也能恢复线段长度；外推出了图像的一端用最外侧的采样点
+ */
+static bool fitTrackedLine(const cv::Mat &img, const vector<Point2f> &pts, const vector<float> &s,
+                           const KeyLine &prev, KeyLine &kl)
+{
+    if ((int)pts.size() < LINE_KLT_MIN_SAMPLES)
+        return false;
+
+    cv::Vec4f fit;
+    cv::fitLine(pts, fit, cv::DIST_HUBER, 0, 0.01, 0.01);
+    Point2f d(fit[0], fit[1]), p0(fit[2], fit[3]);
+    if (d.dot(prev.getEndPoint() - prev.getStartPoint()) < 0)   // 方向和上一帧保持一致
+        d = -d;
+
+    int n = 0;
+    double sum_s = 0, sum_t = 0, sum_ss = 0, sum_st = 0;
+    float s_min = 1, s_max = 0;
+    for (size_t i = 0; i < pts.size(); i++)
+    {
+        Point2f q = pts[i] - p0;
+        if (fabs(q.cross(d)) > LINE_KLT_MAX_DIST)   // 跟到了别的边缘上
+            continue;
+        double t = q.dot(d);
+        n++;
+        sum_s += s[i]; sum_t += t;
+        sum_ss += s[i] * s[i]; sum_st += s[i] * t;
+        s_min = min(s_min, s[i]);
+        s_max = max(s_max, s[i]);
+    }
+    double den = n * sum_ss - sum_s * sum_s;
+    if (n < LINE_KLT_MIN_SAMPLES || den < 1e-6)
+        return false;
+    double b = (n * sum_st - sum_s * sum_t) / den;   // 整条线段的长度
+    double a = (sum_t - b * sum_s) / n;
+    if (b < LINE_MIN_LENGTH)
+        return false;
+
+    Point2f sp = p0 + float(a) * d, ep = p0 + float(a + b) * d;
+    if (!inImage(img, sp))
+        sp = p0 + float(a + b * s_min) * d;
+    if (!inImage(img, ep))
+        ep = p0 + float(a + b * s_max) * d;
+
+    kl = prev;
+    kl.startPointX = kl.sPointInOctaveX = sp.x;
+    kl.startPointY = kl.sPointInOctaveY = sp.y;
+    kl.endPointX = kl.ePointInOctaveX = ep.x;
+    kl.endPointY = kl.ePointInOctaveY = ep.y;
+    kl.lineLength = cv::norm(ep - sp);
+    kl.angle = atan2(ep.y - sp.y, ep.x - sp.x);
+    kl.pt = 0.5f * (sp + ep);
+    return kl.lineLength >= LINE_MIN_LENGTH;
+}
+
+// 新检测的线和已跟踪的某条线方向一致、中点落在它上面，认为是同一条线
+static bool isDuplicateLine(const KeyLine &kl, const vector<KeyLine> &lines)
+{
+    const float min_cos = cos(LINE_DUP_MAX_ANGLE);
+    Point2f mid = 0.5f * (kl.getStartPoint() + kl.getEndPoint());
+    Point2f dir = kl.getEndPoint() - kl.getStartPoint();
+    for (const KeyLine &l : lines)
+    {
+        Point2f d = l.getEndPoint() - l.getStartPoint();
+        float len = cv::norm(d);
+        if (fabs(dir.dot(d)) < min_cos * cv::norm(dir) * len)
+            continue;
+        d *= 1.0f / len;
+        Point2f q = mid - l.getStartPoint();
+        float t = q.dot(d);
+        if (fabs(q.cross(d)) < LINE_DUP_DIST && t > -LINE_DUP_DIST && t < len + LINE_DUP_DIST)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * 光流跟踪线段：每条线上均匀取LINE_KLT_SAMPLES个点做LK，跟踪上的点重新拟合成线段，id沿用上一帧；
+ * 描述子只有左右目匹配用，STEREO_LINE时在新位置上重算，否则沿用。
+ * 只有跟踪上的线少于LINE_MIN_TRACKED或者后端定了关键帧时才做LSD+LBD，补充和已跟踪的线不重复的新线
+ */
+void LineFeatureTracker::trackLinesKLT()
+{
+    TicToc t_klt;
+    const vector<KeyLine> &cur_lines = curframe_->keylsd;
+    vector<Point2f> pts, next_pts;
+    vector<float> ratio;
+    pts.reserve(cur_lines.size() * LINE_KLT_SAMPLES);
+    next_pts.reserve(cur_lines.size() * LINE_KLT_SAMPLES);
+    for (size_t j = 0; j < cur_lines.size(); j++)
+    {
+        Point2f sp = cur_lines[j].getStartPoint(), ep = cur_lines[j].getEndPoint();
+        Point2f ps = sp, pe = ep;   // 光流初值，有IMU预测时用预测的端点
+        auto it = hasPrediction ? predict_lines.find(curframe_->lineID[j]) : predict_lines.end();
+        if (it != predict_lines.end())
+        {
+            ps = it->second.first;
+            pe = it->second.second;
+        }
+        for (int k = 0; k < LINE_KLT_SAMPLES; k++)
+        {
+            float r = float(k) / (LINE_KLT_SAMPLES - 1);
+            pts.push_back(sp + r * (ep - sp));
+            next_pts.push_back(ps + r * (pe - ps));
+            if (j == 0)
+                ratio.push_back(r);
+        }
+    }
+
+    vector<uchar> status;
+    if (!pts.empty())
+    {
+        vector<float> err;
+        cv::TermCriteria criteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01);
+        cv::calcOpticalFlowPyrLK(curframe_->img, forwframe_->img, pts, next_pts, status, err, cv::Size(21, 21), 3,
+                                 criteria, cv::OPTFLOW_USE_INITIAL_FLOW);
+        if (FLOW_BACK)
+        {
+            vector<uchar> reverse_status;
+            vector<Point2f> reverse_pts = pts;
+            cv::calcOpticalFlowPyrLK(forwframe_->img, curframe_->img, next_pts, reverse_pts, reverse_status, err, cv::Size(21, 21), 1,
+                                     criteria, cv::OPTFLOW_USE_INITIAL_FLOW);
+            for (size_t i = 0; i < status.size(); i++)
+            {
+                Point2f e = pts[i] - reverse_pts[i];
+                status[i] = status[i] && reverse_status[i] && e.dot(e) <= 0.25;
+            }
+        }
+    }
+
+    vector<KeyLine> tracked;
+    vector<int> tracked_id, tracked_cnt;
+    Mat tracked_descr;
+    vector<DMatch> good_matches;
+    vector<Point2f> line_pts;
+    vector<float> line_s;
+    for (size_t j = 0; j < cur_lines.size(); j++)
+    {
+        line_pts.clear();
+        line_s.clear();
+        for (int k = 0; k < LINE_KLT_SAMPLES; k++)
+        {
+            size_t i = j * LINE_KLT_SAMPLES + k;
+            if (status[i] && inImage(forwframe_->img, next_pts[i]))
+            {
+                line_pts.push_back(next_pts[i]);
+                line_s.push_back(ratio[k]);
+            }
+        }
+        KeyLine kl;
+        if (!fitTrackedLine(forwframe_->img, line_pts, line_s, cur_lines[j], kl))
+            continue;
+        kl.class_id = tracked.size();
+        good_matches.push_back(DMatch(tracked.size(), j, 0));
+        tracked.push_back(kl);
+        tracked_id.push_back(curframe_->lineID[j]);
+        tracked_cnt.push_back(curframe_->trackCnt[j] + 1);
+        tracked_descr.push_back(curframe_->lbd_descr.row(j));
+    }
+    sum_time += t_klt.toc();
+
+    // 沿用的描述子是线段上次检测时的，左右目匹配要用当前位置重新算
+    if (STEREO_LINE && !tracked.empty())
+    {
+        TicToc t_lbd;
+        bd_->compute(forwframe_->img, tracked, tracked_descr);
+        sum_time += t_lbd.toc();
+    }
+
+    forwframe_->keylsd = tracked;
+    forwframe_->lineID = tracked_id;
+    forwframe_->trackCnt = tracked_cnt;
+    forwframe_->lbd_descr = tracked_descr;
+    showLineMatch(good_matches);
+
+    bool keyframe = detect_request.exchange(false);
+    if (keyframe || (int)tracked.size() < LINE_MIN_TRACKED)
+    {
+        std::vector<KeyLine> keylsd;
+        Mat keylbd_descr;
+        extractLines(forwframe_->img, keylsd, keylbd_descr);
+        for (size_t i = 0; i < keylsd.size(); i++)
+        {
+            if (isDuplicateLine(keylsd[i], tracked))
+                continue;
+            keylsd[i].class_id = forwframe_->keylsd.size();
+            forwframe_->keylsd.push_back(keylsd[i]);
+            forwframe_->lineID.push_back(allfeature_cnt++);
+            forwframe_->trackCnt.push_back(1);
+            forwframe_->lbd_descr.push_back(keylbd_descr.row(i));
+        }
+    }
+    mean_time = sum_time/frame_cnt;
+}
 
-    imshow( "LSD matches", lsd_outImg );
-    */
-    // imshow("LSD matches1", img1);
-    imshow("LSD matches2", img2);
-    waitKey(1);
+// 线段两侧的平均灰度差(0~1)，沿线段取几个点，在法向上前后各走2个像素比较
+static float lineGradient(const cv::Mat &img, const KeyLine &kl)
+{
+    const int SAMPLES = 8;
+    Point2f sp = kl.getStartPoint(), ep = kl.getEndPoint();
+    Point2f d = ep - sp;
+    float len = cv::norm(d);
+    if (len < 1e-3)
+        return 0;
+    Point2f n(-2.0f * d.y / len, 2.0f * d.x / len);
+    float sum = 0;
+    int cnt = 0;
+    for (int k = 0; k < SAMPLES; k++)
+    {
+        Point2f p = sp + (k + 0.5f) / SAMPLES * d;
+        cv::Point a(cvRound(p.x + n.x), cvRound(p.y + n.y)), b(cvRound(p.x - n.x), cvRound(p.y - n.y));
+        if (a.x < 0 || a.y < 0 || b.x < 0 || b.y < 0 ||
+            a.x >= img.cols || b.x >= img.cols || a.y >= img.rows || b.y >= img.rows)
+            continue;
+        sum += fabs(float(img.at<uchar>(a)) - float(img.at<uchar>(b)));
+        cnt++;
+    }
+    return cnt > 0 ? sum / cnt / 255.0f : 0;
 }
 
+/**
+ * 线特征预算：按长度、两侧灰度差和跟踪帧数打分，最多留MAX_LINE_CNT条。
+ * 先按分数从高到低选，每个网格不超过平均份额的两倍以保证分布，没选满再不限网格补齐。
+ * 这样后端每帧的线参数块和线残差数目有上界
+ */
+void LineFeatureTracker::applyLineBudget()
+{
+    FrameLines &f = *forwframe_;
+    int n = f.keylsd.size();
+    if (n <= MAX_LINE_CNT)
+        return;
+
+    float diag = std::hypot(float(f.img.cols), float(f.img.rows));
+    vector<float> score(n);
+    vector<int> order(n);
+    for (int i = 0; i < n; i++)
+    {
+        score[i] = LINE_SCORE_LENGTH * f.keylsd[i].lineLength / diag
+                 + LINE_SCORE_GRADIENT * lineGradient(f.img, f.keylsd[i])
+                 + LINE_SCORE_AGE * min(f.trackCnt[i], LINE_AGE_SATURATION) / float(LINE_AGE_SATURATION);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&score](int a, int b) { return score[a] > score[b]; });
+
+    const int cells = LINE_BUDGET_GRID * LINE_BUDGET_GRID;
+    const int cell_cap = max(1, 2 * MAX_LINE_CNT / cells);
+    vector<int> cell_cnt(cells, 0);
+    vector<bool> keep(n, false);
+    int kept = 0;
+    for (int i : order)
+    {
+        if (kept >= MAX_LINE_CNT)
+            break;
+        Point2f mid = 0.5f * (f.keylsd[i].getStartPoint() + f.keylsd[i].getEndPoint());
+        int gx = min(max(int(mid.x * LINE_BUDGET_GRID / f.img.cols), 0), LINE_BUDGET_GRID - 1);
+        int gy = min(max(int(mid.y * LINE_BUDGET_GRID / f.img.rows), 0), LINE_BUDGET_GRID - 1);
+        int &c = cell_cnt[gy * LINE_BUDGET_GRID + gx];
+        if (c >= cell_cap)
+            continue;
+        c++;
+        keep[i] = true;
+        kept++;
+    }
+    for (int i : order)   // 网格份额限制下没选满
+    {
+        if (kept >= MAX_LINE_CNT)
+            break;
+        if (!keep[i])
+        {
+            keep[i] = true;
+            kept++;
+        }
+    }
+
+    vector<KeyLine> keylsd;
+    vector<int> lineID, trackCnt;
+    Mat lbd_descr;
+    for (int i = 0; i < n; i++)
+    {
+        if (!keep[i])
+            continue;
+        keylsd.push_back(f.keylsd[i]);
+        keylsd.back().class_id = keylsd.size() - 1;
+        lineID.push_back(f.lineID[i]);
+        trackCnt.push_back(f.trackCnt[i]);
+        lbd_descr.push_back(f.lbd_descr.row(i));
+    }
+    f.keylsd = keylsd;
+    f.lineID = lineID;
+    f.trackCnt = trackCnt;
+    f.lbd_descr = lbd_descr;
+}
 
-map<int, vector<pair<int, Eigen::Matrix<double, 4, 1>>>> LineFeatureTracker::trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1)
+void LineFeatureTracker::trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1, FeatureFrame &frame)
 
 // map<int, vector<pair<int, Vector4d>>> LineFeatureTracker::trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1)
 {
     cv::Mat img;
     TicToc t_p;
     frame_cnt++;
+    cur_time = _cur_time;
 
     /**Void remap(InputArray src,OutputArray dst,InputArray map1,InputArray map2,
                     int interpolation,int borderMode=BORDER_CONSTANT,const Scalar&borderValue=Scalar())
@@ -401,11 +950,19 @@ map<int, vector<pair<int, Eigen::Matrix<double, 4, 1>>>> LineFeatureTracker::tra
       borderMode：表示边界插值类型
       borderValue：表示插值数值
      */
-    cv::remap(_img, img, undist_map1_, undist_map2_, CV_INTER_LINEAR);
-    if (EQUALIZE)   // 直方图均衡化
+    if (LINE_ENDPOINT_UNDISTORT)   // 在原图上检测，只对端点去畸变
     {
-        cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(3.0, cv::Size(8, 8));
-        clahe->apply(img, img);
+        // 帧里要保留图像，输入可能引用ROS消息的内存，所以均衡化输出或拷贝到新的Mat
+        if (EQUALIZE)
+            clahe_->apply(_img, img);
+        else
+            _img.copyTo(img);
+    }
+    else
+    {
+        cv::remap(_img, img, undist_map1_, undist_map2_, CV_INTER_LINEAR);
+        if (EQUALIZE)   // 直方图均衡化
+            clahe_->apply(img, img);
     }
 
     bool first_img = false;
@@ -423,115 +980,106 @@ map<int, vector<pair<int, Eigen::Matrix<double, 4, 1>>>> LineFeatureTracker::tra
         forwframe_->img = img;
     }
 
-    // step 1: line extraction
-    TicToc t_li;
-    std::vector<KeyLine> lsd, keylsd;
-    Ptr<LSDDetector> lsd_;
-    lsd_ = cv::line_descriptor::LSDDetector::createLSDDetector();
-    lsd_->detect( img, lsd, 2, 2 );
-
-    sum_time += t_li.toc();
-
-    Mat lbd_descr, keylbd_descr;
-    // step 2: lbd descriptor
-    TicToc t_lbd;
-    Ptr<BinaryDescriptor> bd_ = BinaryDescriptor::createBinaryDescriptor( );
-    bd_->compute( img, lsd, lbd_descr );
-
-//////////////////////////
-    for ( int i = 0; i < (int) lsd.size(); i++ )
+    if (LINE_KLT_TRACK && !first_img)
+        trackLinesKLT();
+    else
     {
-        if( lsd[i].octave == 0 && lsd[i].lineLength >= 30)
-        {
-            keylsd.push_back( lsd[i] );
-            keylbd_descr.push_back( lbd_descr.row( i ) );
+        // step 1, 2: LSD + LBD
+        std::vector<KeyLine> keylsd;
+        Mat keylbd_descr;
+        extractLines(img, keylsd, keylbd_descr);
+
+        forwframe_->keylsd = keylsd;
+        forwframe_->lbd_descr = keylbd_descr;
+        forwframe_->trackCnt.assign(keylsd.size(), 1);
+
+        for (size_t i = 0; i < forwframe_->keylsd.size(); ++i) {
+            if(first_img)
+                forwframe_->lineID.push_back(allfeature_cnt++);
+            else
+                forwframe_->lineID.push_back(-1);   // give a negative id
         }
-    }
-    sum_time += keylsd.size() * t_lbd.toc() / lsd.size();
-///////////////
 
-    forwframe_->keylsd = keylsd;
-    forwframe_->lbd_descr = keylbd_descr;
-
-    for (size_t i = 0; i < forwframe_->keylsd.size(); ++i) {
-        if(first_img)
-            forwframe_->lineID.push_back(allfeature_cnt++);
-        else
-            forwframe_->lineID.push_back(-1);   // give a negative id
-    }
-
-    if(curframe_->keylsd.size() > 0)
-    {
-        /* compute matches */
-        TicToc t_match;
-        std::vector<DMatch> lsd_matches;
-        Ptr<BinaryDescriptorMatcher> bdm_;
-        bdm_ = BinaryDescriptorMatcher::createBinaryDescriptorMatcher();
-        bdm_->match(forwframe_->lbd_descr, curframe_->lbd_descr, lsd_matches);
-        sum_time += t_match.toc();
-        mean_time = sum_time/frame_cnt;
-
-        /* select best matches */
-        std::vector<DMatch> good_matches;
-        std::vector<KeyLine> good_Keylines;
-        good_matches.clear();
-        for ( int i = 0; i < (int) lsd_matches.size(); i++ )
+        if(curframe_->keylsd.size() > 0)
         {
-            if( lsd_matches[i].distance < MATCHES_DIST_THRESHOLD ){
+            /* compute matches */
+            TicToc t_match;
+            std::vector<DMatch> good_matches;
+            if (LINE_PREDICT_MATCH)
+                matchLinesGated(good_matches);
+            else
+            {
+                std::vector<DMatch> lsd_matches;
+                bdm_->match(forwframe_->lbd_descr, curframe_->lbd_descr, lsd_matches);
 
-                DMatch mt = lsd_matches[i];
-                KeyLine line1 =  forwframe_->keylsd[mt.queryIdx] ;
-                KeyLine line2 =  curframe_->keylsd[mt.trainIdx] ;
-                Point2f serr = line1.getStartPoint() - line2.getStartPoint();
-                Point2f eerr = line1.getEndPoint() - line2.getEndPoint();
-                if((serr.dot(serr) < 60 * 60) && (eerr.dot(eerr) < 60 * 60))   // 线段在图像里不会跑得特别远
-                    good_matches.push_back( lsd_matches[i] );
+                /* select best matches */
+                for ( int i = 0; i < (int) lsd_matches.size(); i++ )
+                {
+                    if( lsd_matches[i].distance < MATCHES_DIST_THRESHOLD ){
+
+                        DMatch mt = lsd_matches[i];
+                        KeyLine line1 =  forwframe_->keylsd[mt.queryIdx] ;
+                        KeyLine line2 =  curframe_->keylsd[mt.trainIdx] ;
+                        Point2f serr = line1.getStartPoint() - line2.getStartPoint();
+                        Point2f eerr = line1.getEndPoint() - line2.getEndPoint();
+                        if((serr.dot(serr) < 60 * 60) && (eerr.dot(eerr) < 60 * 60))   // 线段在图像里不会跑得特别远
+                            good_matches.push_back( lsd_matches[i] );
+                    }
+                }
             }
-        }
+            sum_time += t_match.toc();
+            mean_time = sum_time/frame_cnt;
 
-        std::cout << forwframe_->lineID.size() <<" " <<curframe_->lineID.size();
-        for (int k = 0; k < good_matches.size(); ++k) {
-            DMatch mt = good_matches[k];
-            forwframe_->lineID[mt.queryIdx] = curframe_->lineID[mt.trainIdx];
+            for (int k = 0; k < good_matches.size(); ++k) {
+                DMatch mt = good_matches[k];
+                forwframe_->lineID[mt.queryIdx] = curframe_->lineID[mt.trainIdx];
+                forwframe_->trackCnt[mt.queryIdx] = curframe_->trackCnt[mt.trainIdx] + 1;
 
-        }
-        visualize_line_match(forwframe_->img.clone(), curframe_->img.clone(), forwframe_->keylsd, curframe_->keylsd, good_matches, lsd_matches);
+            }
+            showLineMatch(good_matches);
 
-        vector<KeyLine> vecLine_tracked, vecLine_new;
-        vector< int > lineID_tracked, lineID_new;
-        Mat DEscr_tracked, Descr_new;
+            vector<KeyLine> vecLine_tracked, vecLine_new;
+            vector< int > lineID_tracked, lineID_new;
+            vector< int > trackCnt_tracked;
+            Mat DEscr_tracked, Descr_new;
 
-        // 将跟踪的线和没跟踪上的线进行区分 
-        for (size_t i = 0; i < forwframe_->keylsd.size(); ++i)
-        {
-            if( forwframe_->lineID[i] == -1)
+            // 将跟踪的线和没跟踪上的线进行区分 
+            for (size_t i = 0; i < forwframe_->keylsd.size(); ++i)
             {
-                forwframe_->lineID[i] = allfeature_cnt++;
-                vecLine_new.push_back(forwframe_->keylsd[i]);
-                lineID_new.push_back(forwframe_->lineID[i]);
-                Descr_new.push_back( forwframe_->lbd_descr.row( i ) );
+                if( forwframe_->lineID[i] == -1)
+                {
+                    forwframe_->lineID[i] = allfeature_cnt++;
+                    vecLine_new.push_back(forwframe_->keylsd[i]);
+                    lineID_new.push_back(forwframe_->lineID[i]);
+                    Descr_new.push_back( forwframe_->lbd_descr.row( i ) );
+                }
+                else
+                {
+                    vecLine_tracked.push_back(forwframe_->keylsd[i]);
+                    lineID_tracked.push_back(forwframe_->lineID[i]);
+                    trackCnt_tracked.push_back(forwframe_->trackCnt[i]);
+                    DEscr_tracked.push_back( forwframe_->lbd_descr.row( i ) );
+                }
             }
-            else
+            int diff_n = LINE_MIN_TRACKED - vecLine_tracked.size();  // 跟踪的线特征少于50了，那就补充新的线特征, 还差多少条线
+            if( diff_n > 0 || MAX_LINE_CNT > 0)    // 补充线条，有预算时由applyLineBudget挑选
             {
-                vecLine_tracked.push_back(forwframe_->keylsd[i]);
-                lineID_tracked.push_back(forwframe_->lineID[i]);
-                DEscr_tracked.push_back( forwframe_->lbd_descr.row( i ) );
-            }
-        }
-        int diff_n = 50 - vecLine_tracked.size();  // 跟踪的线特征少于50了，那就补充新的线特征, 还差多少条线
-        if( diff_n > 0)    // 补充线条
-        {
-            for (int k = 0; k < vecLine_new.size(); ++k) {
-                vecLine_tracked.push_back(vecLine_new[k]);
-                lineID_tracked.push_back(lineID_new[k]);
-                DEscr_tracked.push_back(Descr_new.row(k));
+                for (int k = 0; k < vecLine_new.size(); ++k) {
+                    vecLine_tracked.push_back(vecLine_new[k]);
+                    lineID_tracked.push_back(lineID_new[k]);
+                    trackCnt_tracked.push_back(1);
+                    DEscr_tracked.push_back(Descr_new.row(k));
+                }
             }
-        }
 
-        forwframe_->keylsd = vecLine_tracked;
-        forwframe_->lineID = lineID_tracked;
-        forwframe_->lbd_descr = DEscr_tracked;
+            forwframe_->keylsd = vecLine_tracked;
+            forwframe_->lineID = lineID_tracked;
+            forwframe_->trackCnt = trackCnt_tracked;
+            forwframe_->lbd_descr = DEscr_tracked;
+        }
     }
+    if (MAX_LINE_CNT > 0)
+        applyLineBudget();
 
     for (int j = 0; j < forwframe_->keylsd.size(); ++j) {
         Line l;
@@ -542,12 +1090,12 @@ map<int, vector<pair<int, Eigen::Matrix<double, 4, 1>>>> LineFeatureTracker::tra
         forwframe_->vecLine.push_back(l);
     }
     curframe_ = forwframe_;
+    hasPrediction = false;
 
-    map<int, vector<pair<int,  Eigen::Matrix<double, 4, 1>>>> linefeatureFrame;
-
-    auto un_lines = undistortedLineEndPoints();
+    auto un_lines = LINE_ENDPOINT_UNDISTORT ? undistortedLineEndPointsMei(m_camera) : undistortedLineEndPoints();
 
     auto &ids = curframe_->lineID; // ??????????????????
+    frame.reserveLines(ids.size());
     for (size_t j = 0; j < ids.size(); j++)
     {
         int p_id = ids[j];
@@ -561,10 +1109,11 @@ map<int, vector<pair<int, Eigen::Matrix<double, 4, 1>>>> LineFeatureTracker::tra
         Eigen::Matrix<double, 4, 1> line_points;
         line_points << x_startpoint, y_startpoint, x_endpoint, y_endpoint;
 
-        linefeatureFrame[p_id].emplace_back(camera_id, line_points);
+        frame.addLine(p_id, camera_id, line_points);
     }
 
-    return linefeatureFrame;
+    if (STEREO_LINE && !_img1.empty())
+        matchStereoLines(_img1, frame);
 }
 
 
@@ -579,10 +1128,7 @@ void LineFeatureTracker::readImage(const cv::Mat &_img)
 //    cv::imshow("lineimg",img);
 //    cv::waitKey(1);
     // if (EQUALIZE)   // 直方图均衡化
-    // {
-        cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(3.0, cv::Size(8, 8));
-        clahe->apply(img, img);
-    // }
+        clahe_->apply(img, img);
 
 
     bool first_img = false;
@@ -600,32 +1146,10 @@ void LineFeatureTracker::readImage(const cv::Mat &_img)
         forwframe_->img = img;
     }
 
-    // step 1: line extraction
-    TicToc t_li;
-    std::vector<KeyLine> lsd, keylsd;
-    Ptr<LSDDetector> lsd_;
-    lsd_ = cv::line_descriptor::LSDDetector::createLSDDetector();
-    lsd_->detect( img, lsd, 2, 2 );
-
-    sum_time += t_li.toc();
-
-    Mat lbd_descr, keylbd_descr;
-    // step 2: lbd descriptor
-    TicToc t_lbd;
-    Ptr<BinaryDescriptor> bd_ = BinaryDescriptor::createBinaryDescriptor( );
-    bd_->compute( img, lsd, lbd_descr );
-
-//////////////////////////
-    for ( int i = 0; i < (int) lsd.size(); i++ )
-    {
-        if( lsd[i].octave == 0 && lsd[i].lineLength >= 30)
-        {
-            keylsd.push_back( lsd[i] );
-            keylbd_descr.push_back( lbd_descr.row( i ) );
-        }
-    }
-    sum_time += keylsd.size() * t_lbd.toc() / lsd.size();
-///////////////
+    // step 1, 2: LSD + LBD
+    std::vector<KeyLine> keylsd;
+    Mat keylbd_descr;
+    extractLines(img, keylsd, keylbd_descr);
 
     forwframe_->keylsd = keylsd;
     forwframe_->lbd_descr = keylbd_descr;
@@ -642,8 +1166,6 @@ void LineFeatureTracker::readImage(const cv::Mat &_img)
         /* compute matches */
         TicToc t_match;
         std::vector<DMatch> lsd_matches;
-        Ptr<BinaryDescriptorMatcher> bdm_;
-        bdm_ = BinaryDescriptorMatcher::createBinaryDescriptorMatcher();
         bdm_->match(forwframe_->lbd_descr, curframe_->lbd_descr, lsd_matches);
         sum_time += t_match.toc();
         mean_time = sum_time/frame_cnt;
@@ -665,13 +1187,11 @@ void LineFeatureTracker::readImage(const cv::Mat &_img)
                     good_matches.push_back( lsd_matches[i] );
             }
         }
-        std::cout << forwframe_->lineID.size() <<" " <<curframe_->lineID.size();
         for (int k = 0; k < good_matches.size(); ++k) {
             DMatch mt = good_matches[k];
             forwframe_->lineID[mt.queryIdx] = curframe_->lineID[mt.trainIdx];
 
         }
-        visualize_line_match(forwframe_->img.clone(), curframe_->img.clone(), forwframe_->keylsd, curframe_->keylsd, good_matches, lsd_matches);
 
         vector<KeyLine> vecLine_tracked, vecLine_new;
         vector< int > lineID_tracked, lineID_new;
@@ -4,6 +4,9 @@
 
 #include <iostream>
 #include <queue>
+#include <functional>
+#include <future>
+#include <atomic>
 
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/image_encodings.h>
@@ -14,9 +17,13 @@
 #include "camodocal/camera_models/CataCamera.h"
 #include "camodocal/camera_models/PinholeCamera.h"
 #include "camodocal/camera_models/EquidistantCamera.h"
+#include "camodocal/camera_models/UndistortLUT.h"
 
 #include "../estimator/parameters.h"
+#include "../estimator/feature_frame.h"
 #include "../utility/tic_toc.h"
+#include "../utility/thread_pool.h"
+#include "line_detector.h"
 
 #include <opencv2/opencv.hpp>
 
@@ -29,6 +36,25 @@ using namespace cv;
 using namespace camodocal;
 using namespace Eigen;
 
+static const float LINE_MIN_LENGTH = 30;  // 短于该长度(像素)的线段不计算描述子
+static const float LINE_MATCH_GATE = 60;    // 没有预测时端点最大移动距离(像素)，也是匹配网格的边长
+static const float LINE_PREDICT_GATE = 30;  // 有IMU预测时端点与预测位置的最大距离(像素)
+static const double LINE_STRAIGHT_THRESHOLD = 1.0;  // 去畸变后线段中间采样点偏离端点连线的最大距离(像素)
+static const float LINE_STEREO_MAX_ANGLE = 10.0 * M_PI / 180.0;  // 左右目匹配的线段最大夹角
+static const float LINE_STEREO_GATE_Y = 10;  // 左右目线段在竖直方向上至少要重叠到差这么多像素以内
+static const int LINE_MIN_TRACKED = 50;      // 跟踪上的线少于该数目时补充新线
+static const int LINE_KLT_SAMPLES = 8;       // 光流跟踪线段时每条线上的采样点数(含端点)
+static const int LINE_KLT_MIN_SAMPLES = 5;   // 至少跟踪上这么多个采样点才重新拟合
+static const float LINE_KLT_MAX_DIST = 1.5;  // 采样点到拟合直线的最大距离(像素)
+static const float LINE_DUP_DIST = 3;        // 新检测的线和已跟踪的线重合的距离门限(像素)
+static const float LINE_DUP_MAX_ANGLE = 10.0 * M_PI / 180.0;  // 新检测的线和已跟踪的线重合的最大夹角
+static const float LINE_FRAGMENT_GAP = 10;   // MAX_LINE_CNT > 0时，共线且空隙小于该值(像素)的碎线段合并成一条
+static const int LINE_BUDGET_GRID = 4;       // 线特征预算按LINE_BUDGET_GRID x LINE_BUDGET_GRID的网格分散
+static const float LINE_SCORE_LENGTH = 1.0;  // 打分权重：长度(相对图像对角线)
+static const float LINE_SCORE_GRADIENT = 1.0;   // 打分权重：线段两侧的平均灰度差(/255)
+static const float LINE_SCORE_AGE = 1.0;     // 打分权重：跟踪帧数，LINE_AGE_SATURATION帧以上算满分
+static const int LINE_AGE_SATURATION = 10;
+
 struct Line
 {
 	Point2f StartPt;
@@ -66,6 +92,7 @@ public:
     
     vector<Line> vecLine;
     vector< int > lineID;
+    vector< int > trackCnt;   // 每条线已经被跟踪的帧数
 
     // opencv3 lsd+lbd
     std::vector<KeyLine> keylsd;
@@ -78,26 +105,58 @@ class LineFeatureTracker
   public:
     LineFeatureTracker();
 
-    void readIntrinsicParameter(const string &calib_file);
+    void readIntrinsicParameter(const vector<string> &calib_file);
     void NearbyLineTracking(const vector<Line> forw_lines, const vector<Line> cur_lines, vector<pair<int, int> >& lineMatches);
 
     vector<Line> undistortedLineEndPoints();
     vector<Line> undistortedLineEndPointsMei(camodocal::CameraPtr cam);
 
+    Eigen::Vector2d liftNormalized(const cv::Point2f &p, int cam = 0);
+    Eigen::Vector4d normalizeLine(const KeyLine &kl, int cam);
+    bool isStraight(const KeyLine &kl, int cam = 0);
+    cv::Point2f projectToImage(const Eigen::Vector3d &pts_cam);
+    void setPrediction(const map<int, pair<Eigen::Vector3d, Eigen::Vector3d>> &predictLines);
+    void matchLinesGated(std::vector<DMatch> &good_matches);
+    void extractLines(const cv::Mat &img, std::vector<KeyLine> &keylsd, cv::Mat &keylbd_descr, int cam = 0);
+    void matchStereoLines(const cv::Mat &_img1, FeatureFrame &frame);
+    void trackLinesKLT();
+    void applyLineBudget();
+    void requestDetection();
     void readImage(const cv::Mat &_img);
-    map<int, vector<pair<int, Eigen::Matrix<double, 4, 1>>>> trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1 = cv::Mat());
+    void setMatchImageCallback(const std::function<void(const cv::Mat &, double)> &callback);
+    void showLineMatch(const std::vector<DMatch> &good_matches);
+    void trackImage(double _cur_time, const cv::Mat &_img, const cv::Mat &_img1, FeatureFrame &frame);
     FrameLinesPtr curframe_, forwframe_;
 
     cv::Mat undist_map1_, undist_map2_ , K_;
+    cv::Mat undist_map1_right_, undist_map2_right_, K_right_;   // STEREO_LINE时右目使用
+
+    LineDetectorPtr detector_;           // line_detector选择的检测器，setParameter里建
+    Ptr<BinaryDescriptor> bd_;
+    Ptr<BinaryDescriptorMatcher> bdm_;
+    Ptr<cv::CLAHE> clahe_;
 
     camodocal::CameraPtr m_camera;       // pinhole camera
+    camodocal::UndistortLUTPtr m_lut;    // undistort_lut开启时有效
+    camodocal::CameraPtr m_camera_right;
+    camodocal::UndistortLUTPtr m_lut_right;
+    vector<string> m_calib_file;         // 上面的内参和去畸变表对应的标定文件
 
     int frame_cnt;
+    bool hasPrediction;
+    map<int, pair<cv::Point2f, cv::Point2f>> predict_lines;  // 线id -> 预测的端点像素坐标
     vector<int> ids;                     // 每个特征点的id
     vector<int> linetrack_cnt;           // 记录某个特征已经跟踪多少帧了，即被多少帧看到了
     int allfeature_cnt;                  // 用来统计整个地图中有了多少条线，它将用来赋值
+    std::atomic<bool> detect_request;    // LINE_KLT_TRACK时后端确定关键帧后置位，下一帧做一次LSD+LBD
 
     double sum_time;
     double mean_time;
 
+    // 线匹配调试图像：SHOW_LINE_TRACK > 0时在单独的线程中绘制并发布
+    double cur_time, last_vis_time;
+    std::function<void(const cv::Mat &, double)> match_image_callback;
+    ThreadPool vis_pool;
+    std::future<void> vis_job;
+
 };
@@ -0,0 +1,167 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#include <stdio.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "featureTracker/line_detector.h"
+#include "utility/tic_toc.h"
+
+using namespace std;
+using cv::line_descriptor::KeyLine;
+
+/**
+ * 线段检测器对比：对目录下的每张图计时、统计线段数，
+ * 并把图像旋转缩放后再检测一次，统计两次都检测到的线段比例(重复率)
+ */
+
+// 已知的图像变换：绕图像中心旋转5度并缩小到0.95
+static cv::Mat testHomography(const cv::Size &size)
+{
+    cv::Point2f center(size.width * 0.5f, size.height * 0.5f);
+    cv::Mat A = cv::getRotationMatrix2D(center, 5.0, 0.95);
+    cv::Mat H = cv::Mat::eye(3, 3, CV_64F);
+    A.copyTo(H.rowRange(0, 2));
+    return H;
+}
+
+static vector<KeyLine> filterLength(const vector<KeyLine> &lines, float min_length)
+{
+    vector<KeyLine> out;
+    for (const KeyLine &kl : lines)
+        if (kl.lineLength >= min_length)
+            out.push_back(kl);
+    return out;
+}
+
+static bool inImage(const cv::Point2f &p, const cv::Size &size)
+{
+    return p.x >= 0 && p.y >= 0 && p.x < size.width && p.y < size.height;
+}
+
+// a和b方向差5度以内，a的中点离b所在直线2像素以内且落在b上
+static bool sameSegment(const cv::Point2f &a0, const cv::Point2f &a1, const cv::Point2f &b0, const cv::Point2f &b1)
+{
+    cv::Point2f da = a1 - a0, db = b1 - b0;
+    float la = cv::norm(da), lb = cv::norm(db);
+    if (fabs(da.dot(db)) < cos(5.0 * M_PI / 180.0) * la * lb)
+        return false;
+    db *= 1.0f / lb;
+    cv::Point2f q = 0.5f * (a0 + a1) - b0;
+    float t = q.dot(db);
+    return fabs(q.cross(db)) < 2.0 && t > 0 && t < lb;
+}
+
+// 原图和变换后的图像中都能看到的线段里，有多少在两幅图中都被检测到
+static double repeatability(const vector<KeyLine> &lines, const vector<KeyLine> &warped_lines,
+                            const cv::Mat &H, const cv::Size &size)
+{
+    vector<cv::Point2f> pts, pts_in_warped;
+    for (const KeyLine &kl : lines)
+    {
+        pts.push_back(kl.getStartPoint());
+        pts.push_back(kl.getEndPoint());
+    }
+    if (pts.empty() || warped_lines.empty())
+        return 0;
+    cv::perspectiveTransform(pts, pts_in_warped, H);
+
+    int visible = 0, repeated = 0;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        cv::Point2f s = pts_in_warped[2 * i], e = pts_in_warped[2 * i + 1];
+        if (!inImage(s, size) || !inImage(e, size))
+            continue;
+        visible++;
+        for (const KeyLine &kl : warped_lines)
+            if (sameSegment(kl.getStartPoint(), kl.getEndPoint(), s, e) ||
+                sameSegment(s, e, kl.getStartPoint(), kl.getEndPoint()))
+            {
+                repeated++;
+                break;
+            }
+    }
+    int n = min(visible, (int)warped_lines.size());
+    return n > 0 ? double(min(repeated, n)) / n : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("please intput: rosrun vins line_detector_benchmark [image folder] [min line length, default 30] [tiles, default 1] \n"
+               "for example: rosrun vins line_detector_benchmark "
+               "~/dataset/MH_01_easy/mav0/cam0/data \n");
+        return 1;
+    }
+    string folder = argv[1];
+    float min_length = argc > 2 ? atof(argv[2]) : 30;
+    int tiles = argc > 3 ? atoi(argv[3]) : 1;
+
+    vector<cv::String> files;
+    cv::glob(folder + "/*.png", files);
+    if (files.empty())
+        cv::glob(folder + "/*.jpg", files);
+    if (files.empty())
+    {
+        printf("no png/jpg image in %s\n", folder.c_str());
+        return 1;
+    }
+
+    vector<LineDetectorPtr> detectors;
+    detectors.push_back(LineDetector::create(LINE_DETECTOR_LSD));
+    LineDetectorPtr fld = LineDetector::create(LINE_DETECTOR_FLD);
+    if (fld->name() != detectors[0]->name())
+        detectors.push_back(fld);
+    if (tiles > 1)   // 分块并行检测，和整图检测对比耗时和重复率
+    {
+        for (size_t i = 0, n = detectors.size(); i < n; i++)
+            detectors.push_back(LineDetector::create(i == 0 ? LINE_DETECTOR_LSD : LINE_DETECTOR_FLD, tiles));
+    }
+
+    printf("%zu images, min line length %.0f px\n", files.size(), min_length);
+    printf("%-8s %12s %12s %10s %10s %14s\n", "detector", "mean ms", "max ms", "lines", "kept", "repeatability");
+    for (LineDetectorPtr &detector : detectors)
+    {
+        double sum_time = 0, max_time = 0, sum_rep = 0;
+        long sum_lines = 0, sum_kept = 0;
+        int n = 0;
+        vector<KeyLine> lines, warped_lines;
+        for (const cv::String &file : files)
+        {
+            cv::Mat img = cv::imread(file, cv::IMREAD_GRAYSCALE);
+            if (img.empty())
+                continue;
+
+            TicToc t_detect;
+            detector->detect(img, lines);
+            double t = t_detect.toc();
+            sum_time += t;
+            max_time = max(max_time, t);
+            sum_lines += lines.size();
+            lines = filterLength(lines, min_length);
+            sum_kept += lines.size();
+
+            cv::Mat H = testHomography(img.size());
+            cv::Mat warped;
+            cv::warpPerspective(img, warped, H, img.size());
+            detector->detect(warped, warped_lines);
+            sum_rep += repeatability(lines, filterLength(warped_lines, min_length), H, img.size());
+            n++;
+        }
+        if (n == 0)
+            continue;
+        printf("%-8s %12.2f %12.2f %10.1f %10.1f %14.3f\n", detector->name().c_str(),
+               sum_time / n, max_time, double(sum_lines) / n, double(sum_kept) / n, sum_rep / n);
+    }
+    return 0;
+}
@@ -14,7 +14,9 @@
 #include <map>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <ros/ros.h>
+#include <boost/make_shared.hpp>
 #include <cv_bridge/cv_bridge.h>
 #include <opencv2/opencv.hpp>
 
@@ -33,6 +35,8 @@ queue<sensor_msgs::PointCloudConstPtr> feature_buf;
 queue<sensor_msgs::ImageConstPtr> img0_buf;
 queue<sensor_msgs::ImageConstPtr> img1_buf;
 std::mutex m_buf;
+std::condition_variable con_img;  // 收到图像时唤醒sync_thread
+cv::Mat img_convert_buf[2];       // 彩色图转灰度的缓冲区，只在sync_thread中使用
 
 /**
  * 获得左目的message
@@ -42,6 +46,7 @@ void img0_callback(const sensor_msgs::ImageConstPtr &img_msg)
     m_buf.lock();
     img0_buf.push(img_msg);
     m_buf.unlock();
+    con_img.notify_one();
 }
 
 /**
@@ -52,31 +57,34 @@ void img1_callback(const sensor_msgs::ImageConstPtr &img_msg)
     m_buf.lock();
     img1_buf.push(img_msg);
     m_buf.unlock();
+    con_img.notify_one();
 }
 /**
- * 从msg中获取图片，返回值cv：：Mat，输入是当前图像msg的指针,cv::Mat是opencv库中用于存储和处理图像数据的矩阵类
+ * 从msg中获取灰度图。mono8/8UC1直接共享消息的内存(toCvShare)，不做拷贝；
+ * 返回的指针持有消息，调用者要保留到estimator.inputImage返回，期间前端只读这块内存。
+ * 彩色图转换到按相机复用的缓冲区img_convert_buf中
  */
-cv::Mat getImageFromMsg(const sensor_msgs::ImageConstPtr &img_msg)
+cv_bridge::CvImageConstPtr getImageFromMsg(const sensor_msgs::ImageConstPtr &img_msg, int cam)
 {
-    cv_bridge::CvImageConstPtr ptr;
-    if (img_msg->encoding == "8UC1")
-    {
-        sensor_msgs::Image img;
-        img.header = img_msg->header;
-        img.height = img_msg->height;
-        img.width = img_msg->width;
-        img.is_bigendian = img_msg->is_bigendian;
-        img.step = img_msg->step;
-        img.data = img_msg->data;
-        img.encoding = "mono8";
-        ptr = cv_bridge::toCvCopy(img, sensor_msgs::image_encodings::MONO8);
-    }
-    else
-        ptr = cv_bridge::toCvCopy(img_msg, sensor_msgs::image_encodings::MONO8);
+    namespace enc = sensor_msgs::image_encodings;
+    if (img_msg->encoding == enc::MONO8 || img_msg->encoding == enc::TYPE_8UC1)
+        return cv_bridge::toCvShare(img_msg, img_msg->encoding);
 
-    cv::Mat img = ptr->image.clone();
-    
-    return img;
+    int code = -1;
+    if (img_msg->encoding == enc::BGR8)
+        code = cv::COLOR_BGR2GRAY;
+    else if (img_msg->encoding == enc::RGB8)
+        code = cv::COLOR_RGB2GRAY;
+    else if (img_msg->encoding == enc::BGRA8)
+        code = cv::COLOR_BGRA2GRAY;
+    else if (img_msg->encoding == enc::RGBA8)
+        code = cv::COLOR_RGBA2GRAY;
+    if (code < 0)   // 其他编码交给cv_bridge转换
+        return cv_bridge::toCvShare(img_msg, enc::MONO8);
+
+    cv_bridge::CvImageConstPtr src = cv_bridge::toCvShare(img_msg);
+    cv::cvtColor(src->image, img_convert_buf[cam], code);   // 尺寸不变时不重新分配内存
+    return boost::make_shared<cv_bridge::CvImage>(img_msg->header, enc::MONO8, img_convert_buf[cam]);
 }
 /**
  * 从两个主题中提取具有相同时间戳的图像，并将图像输入到估计其中
@@ -90,12 +98,17 @@ void sync_process()
 {
     while(1)
     {
+        // 阻塞到有可处理的图像，不再轮询
+        std::unique_lock<std::mutex> lock(m_buf);
+        con_img.wait(lock, []
+                     {
+            return !img0_buf.empty() && (!STEREO || !img1_buf.empty());
+                     });
         if(STEREO)
         {
-            cv::Mat image0, image1;
+            cv_bridge::CvImageConstPtr image0, image1;
             std_msgs::Header header;
             double time = 0;
-            m_buf.lock();
             if (!img0_buf.empty() && !img1_buf.empty())
             {
                 double time0 = img0_buf.front()->header.stamp.toSec();
@@ -115,37 +128,33 @@ void sync_process()
                 {
                     time = img0_buf.front()->header.stamp.toSec();
                     header = img0_buf.front()->header;
-                    image0 = getImageFromMsg(img0_buf.front());
+                    image0 = getImageFromMsg(img0_buf.front(), 0);
                     img0_buf.pop();
-                    image1 = getImageFromMsg(img1_buf.front());
+                    image1 = getImageFromMsg(img1_buf.front(), 1);
                     img1_buf.pop();
                     //printf("find img0 and img1\n");
                 }
             }
-            m_buf.unlock();
-            if(!image0.empty())
-                estimator.inputImage(time, image0, image1);
+            lock.unlock();
+            if(image0)
+                estimator.inputImage(time, image0->image, image1->image);
         }
         else
         {
-            cv::Mat image;
+            cv_bridge::CvImageConstPtr image;
             std_msgs::Header header;
             double time = 0;
-            m_buf.lock();
             if(!img0_buf.empty())
             {
                 time = img0_buf.front()->header.stamp.toSec();
                 header = img0_buf.front()->header;
-                image = getImageFromMsg(img0_buf.front());
+                image = getImageFromMsg(img0_buf.front(), 0);
                 img0_buf.pop();
             }
-            m_buf.unlock();
-            if(!image.empty())
-                estimator.inputImage(time, image);
+            lock.unlock();
+            if(image)
+                estimator.inputImage(time, image->image);
         }
-
-        std::chrono::milliseconds dura(2);
-        std::this_thread::sleep_for(dura);
     }
 }
 
@@ -247,25 +256,16 @@ void cam_switch_callback(const std_msgs::BoolConstPtr &switch_msg)
     {
         estimator.changeSensorType(USE_IMU, 0);
     }
+    con_img.notify_one();  // STEREO变化后重新判断sync_thread的等待条件
     return;
 }
 
-int main(int argc, char **argv)
+/**
+ * 读取配置、注册话题并启动sync_thread，vins_node和VinsNodelet共用
+ */
+void startVinsEstimator(ros::NodeHandle &n, const string &config_file)
 {
-    ros::init(argc, argv, "vins_estimator");
-    ros::NodeHandle n("~");
-    ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Info);
-
-    if(argc != 2)
-    {
-        printf("please intput: rosrun vins vins_node [config file] \n"
-               "for example: rosrun vins vins_node "
-               "~/catkin_ws/src/VINS-Fusion/config/euroc/euroc_stereo_imu_config.yaml \n");
-        return 1;
-    }
-
-    string config_file = argv[1];
-    printf("config_file: %s\n", argv[1]);
+    printf("config_file: %s\n", config_file.c_str());
 
     readParameters(config_file);
     estimator.setParameter();
@@ -278,17 +278,38 @@ int main(int argc, char **argv)
 
     registerPub(n);
 
-    ros::Subscriber sub_imu = n.subscribe(IMU_TOPIC, 2000, imu_callback, ros::TransportHints().tcpNoDelay());
-    // ros::Subscriber sub_feature = n.subscribe("/feature_tracker/feature", 2000, feature_callback);
-    ros::Subscriber sub_img0 = n.subscribe(IMAGE0_TOPIC, 100, img0_callback);
-    ros::Subscriber sub_img1 = n.subscribe(IMAGE1_TOPIC, 100, img1_callback);
+    static ros::Subscriber sub_imu, sub_img0, sub_img1, sub_restart, sub_imu_switch, sub_cam_switch;
+    sub_imu = n.subscribe(IMU_TOPIC, 2000, imu_callback, ros::TransportHints().tcpNoDelay());
+    // sub_feature = n.subscribe("/feature_tracker/feature", 2000, feature_callback);
+    sub_img0 = n.subscribe(IMAGE0_TOPIC, 100, img0_callback);
+    sub_img1 = n.subscribe(IMAGE1_TOPIC, 100, img1_callback);
 
-    ros::Subscriber sub_restart = n.subscribe("/vins_restart", 100, restart_callback);
-    ros::Subscriber sub_imu_switch = n.subscribe("/vins_imu_switch", 100, imu_switch_callback);
-    ros::Subscriber sub_cam_switch = n.subscribe("/vins_cam_switch", 100, cam_switch_callback);
+    sub_restart = n.subscribe("/vins_restart", 100, restart_callback);
+    sub_imu_switch = n.subscribe("/vins_imu_switch", 100, imu_switch_callback);
+    sub_cam_switch = n.subscribe("/vins_cam_switch", 100, cam_switch_callback);
 
     std::thread sync_thread{sync_process};//创建sync_thread线程，指向sync_process，这里边处理了measurementpross的线程
+    sync_thread.detach();
+}
+
+#ifndef VINS_NODELET
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "vins_estimator");
+    ros::NodeHandle n("~");
+    ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Info);
+
+    if(argc != 2)
+    {
+        printf("please intput: rosrun vins vins_node [config file] \n"
+               "for example: rosrun vins vins_node "
+               "~/catkin_ws/src/VINS-Fusion/config/euroc/euroc_stereo_imu_config.yaml \n");
+        return 1;
+    }
+
+    startVinsEstimator(n, argv[1]);
     ros::spin();
 
     return 0;
 }
+#endif
@@ -0,0 +1,378 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#include <stdio.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include <ceres/ceres.h>
+#include <eigen3/Eigen/Dense>
+
+#include "estimator/parameters.h"
+#include "estimator/sliding_window_solver.h"
+#include "factor/pose_local_parameterization.h"
+#include "factor/projectionTwoFrameOneCamFactor.h"
+#include "factor/line_parameterization.h"
+#include "factor/line_projection_factor.h"
+#include "factor/marginalization_factor.h"
+#include "utility/frame_arena.h"
+#include "utility/line_geometry.h"
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * 滑窗求解耗时和ceres线程数的关系。
+ * 按EuRoC双目的规模生成一个WINDOW_SIZE + 1帧的窗口(点、线观测加像素噪声，初值加扰动)，
+ * 用和optimizationwithLine相同的因子和求解器设置，固定迭代次数，分别用1, 2, 4...个线程求解；
+ * 再和SlidingWindowSolver对比单帧求解耗时，以及两者迭代到收敛后的代价和参数差；
+ * 最后统计每帧搭problem、边缘化的堆分配次数，逐个new和用FrameArena对比
+ */
+
+// 替换全局的operator new，统计整个进程(包括ceres、Eigen)的堆分配次数
+static std::atomic<long> heap_allocations(0);
+
+void *operator new(size_t size)
+{
+    heap_allocations++;
+    if (void *p = malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct Window
+{
+    double pose[WINDOW_SIZE + 1][SIZE_POSE];
+    double ex_pose[SIZE_POSE];
+    double td[1];
+    vector<double> inv_depth;
+    vector<Vector4d, aligned_allocator<Vector4d>> line_orth;
+
+    // 点：起始帧、起始帧上的观测、后续帧的观测
+    vector<int> point_start;
+    vector<vector<Vector3d>> point_obs;
+    // 线：每帧的观测
+    vector<vector<Vector4d, aligned_allocator<Vector4d>>> line_obs;
+};
+
+static Vector3d project(const Matrix3d &Rwb, const Vector3d &twb, const Vector3d &pw)
+{
+    Vector3d pc = Rwb.transpose() * (pw - twb);
+    return pc / pc.z();
+}
+
+static void makeWindow(int num_points, int num_lines, Window &w)
+{
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> ux(-3, 6), uy(-2, 2), uz(4, 10);
+    std::normal_distribution<double> pixel(0, 0.5 / FOCAL_LENGTH), noise(0, 1);
+
+    // 相机沿x方向每帧走0.3m并缓慢偏航，body和相机重合
+    Matrix3d R[WINDOW_SIZE + 1];
+    Vector3d t[WINDOW_SIZE + 1];
+    for (int i = 0; i <= WINDOW_SIZE; i++)
+    {
+        R[i] = AngleAxisd(0.02 * i, Vector3d::UnitY()).toRotationMatrix();
+        t[i] = Vector3d(0.3 * i, 0.05 * sin(i), 0);
+        // 第0帧固定，其余帧的初值加扰动
+        Vector3d dt = i == 0 ? Vector3d::Zero() : Vector3d(noise(rng), noise(rng), noise(rng)) * 0.05;
+        Quaterniond q(i == 0 ? R[i] : R[i] * AngleAxisd(0.01, Vector3d(noise(rng), noise(rng), noise(rng)).normalized()).toRotationMatrix());
+        w.pose[i][0] = t[i].x() + dt.x();
+        w.pose[i][1] = t[i].y() + dt.y();
+        w.pose[i][2] = t[i].z() + dt.z();
+        w.pose[i][3] = q.x();
+        w.pose[i][4] = q.y();
+        w.pose[i][5] = q.z();
+        w.pose[i][6] = q.w();
+    }
+    for (int k = 0; k < 6; k++)
+        w.ex_pose[k] = 0;
+    w.ex_pose[6] = 1;
+    w.td[0] = 0;
+
+    std::uniform_int_distribution<int> start(0, WINDOW_SIZE - 3);
+    for (int n = 0; n < num_points; n++)
+    {
+        Vector3d pw(ux(rng), uy(rng), uz(rng));
+        int s = start(rng);
+        int len = std::uniform_int_distribution<int>(3, WINDOW_SIZE + 1 - s)(rng);
+        vector<Vector3d> obs;
+        for (int i = s; i < s + len; i++)
+            obs.push_back(project(R[i], t[i], pw) + Vector3d(pixel(rng), pixel(rng), 0));
+        double depth = (R[s].transpose() * (pw - t[s])).z();
+        w.point_start.push_back(s);
+        w.point_obs.push_back(obs);
+        w.inv_depth.push_back(1.0 / (depth * (1 + 0.1 * noise(rng))));
+    }
+
+    for (int n = 0; n < num_lines; n++)
+    {
+        Vector3d p1(ux(rng), uy(rng), uz(rng));
+        Vector3d p2 = p1 + Vector3d(noise(rng), noise(rng), 0.2 * noise(rng)).normalized() * 1.5;
+        Vector6d plk;
+        plk << p1.cross(p2), p2 - p1;
+        Vector4d orth = plk_to_orth(plk);
+        for (int k = 0; k < 4; k++)
+            orth(k) += 0.01 * noise(rng);
+        w.line_orth.push_back(orth);
+
+        vector<Vector4d, aligned_allocator<Vector4d>> obs;
+        for (int i = 0; i <= WINDOW_SIZE; i++)
+        {
+            Vector3d a = project(R[i], t[i], p1), b = project(R[i], t[i], p2);
+            obs.push_back(Vector4d(a.x() + pixel(rng), a.y() + pixel(rng), b.x() + pixel(rng), b.y() + pixel(rng)));
+        }
+        w.line_obs.push_back(obs);
+    }
+}
+
+// arena为空时new，否则从arena里分配(problem不能接管所有权)
+template <typename T, typename... Args>
+static T *make(FrameArena *arena, Args &&... args)
+{
+    if (arena)
+        return arena->create<T>(std::forward<Args>(args)...);
+    return new T(std::forward<Args>(args)...);
+}
+
+// 路标(逆深度、线)放进landmarks，给SlidingWindowSolver消元
+static void buildProblem(Window &w, ceres::Problem &problem, vector<double *> *landmarks, FrameArena *arena = nullptr)
+{
+    for (int i = 0; i <= WINDOW_SIZE; i++)
+        problem.AddParameterBlock(w.pose[i], SIZE_POSE, make<PoseLocalParameterization>(arena));
+    problem.SetParameterBlockConstant(w.pose[0]);
+    problem.AddParameterBlock(w.ex_pose, SIZE_POSE, make<PoseLocalParameterization>(arena));
+    problem.SetParameterBlockConstant(w.ex_pose);
+    problem.AddParameterBlock(w.td, 1);
+    problem.SetParameterBlockConstant(w.td);
+
+    ceres::LossFunction *loss_function = make<ceres::HuberLoss>(arena, 1.0);
+    for (size_t n = 0; n < w.point_obs.size(); n++)
+    {
+        int s = w.point_start[n];
+        const vector<Vector3d> &obs = w.point_obs[n];
+        for (size_t k = 1; k < obs.size(); k++)
+        {
+            ProjectionTwoFrameOneCamFactor *f = make<ProjectionTwoFrameOneCamFactor>(arena, obs[0], obs[k],
+                Vector2d::Zero(), Vector2d::Zero(), 0.0, 0.0);
+            problem.AddResidualBlock(f, loss_function, w.pose[s], w.pose[s + k], w.ex_pose, &w.inv_depth[n], w.td);
+        }
+        landmarks->push_back(&w.inv_depth[n]);
+    }
+
+    ceres::LossFunction *line_loss_function = make<ceres::CauchyLoss>(arena, 1.0);
+    for (size_t n = 0; n < w.line_obs.size(); n++)
+    {
+        problem.AddParameterBlock(w.line_orth[n].data(), SIZE_LINE, make<LineOrthParameterization>(arena));
+        for (int i = 0; i <= WINDOW_SIZE; i++)
+        {
+            lineProjectionFactor *f = make<lineProjectionFactor>(arena, w.line_obs[n][i]);
+            problem.AddResidualBlock(f, line_loss_function, w.pose[i], w.ex_pose, w.line_orth[n].data());
+        }
+        landmarks->push_back(w.line_orth[n].data());
+    }
+}
+
+// fixed_iterations: 关掉收敛判断，各线程数下的工作量相同
+static ceres::Solver::Summary solveCeres(Window &w, int threads, int iterations, bool fixed_iterations)
+{
+    ceres::Problem problem;
+    vector<double *> landmarks;
+    buildProblem(w, problem, &landmarks);
+
+    ceres::Solver::Options options;
+    options.linear_solver_type = ceres::DENSE_SCHUR;
+    options.trust_region_strategy_type = ceres::DOGLEG;
+    options.num_threads = threads;
+    options.max_num_iterations = iterations;
+    if (fixed_iterations)
+    {
+        options.function_tolerance = 1e-30;
+        options.gradient_tolerance = 1e-30;
+        options.parameter_tolerance = 1e-30;
+    }
+    ceres::Solver::Summary summary;
+    ceres::Solve(options, &problem, &summary);
+    return summary;
+}
+
+static SlidingWindowSolver::Summary solveSchur(Window &w, int iterations, bool fixed_iterations)
+{
+    ceres::Problem problem;
+    vector<double *> landmarks;
+    buildProblem(w, problem, &landmarks);
+
+    SlidingWindowSolver solver;
+    SlidingWindowSolver::Options options;
+    options.max_num_iterations = iterations;
+    if (fixed_iterations)
+    {
+        options.function_tolerance = 0;
+        options.parameter_tolerance = 0;
+    }
+    SlidingWindowSolver::Summary summary;
+    if (!solver.solve(problem, landmarks, options, &summary))
+        printf("sliding window solver failed\n");
+    return summary;
+}
+
+/**
+ * 一帧的工作量：搭problem，再把第0帧和从第0帧开始的点边缘化掉，返回期间的堆分配次数。
+ * problem_arena、marg_arena为空时和原来一样逐个new
+ */
+static long frameAllocations(const Window &w0, FrameArena *problem_arena, FrameArena *marg_arena)
+{
+    Window w = w0;
+    vector<double *> landmarks;
+    landmarks.reserve(w.inv_depth.size() + w.line_orth.size());
+    long before = heap_allocations;
+
+    ceres::Problem::Options problem_options;
+    if (problem_arena)
+    {
+        problem_arena->reset();
+        problem_options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+        problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+        problem_options.local_parameterization_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    }
+    ceres::Problem *problem = new ceres::Problem(problem_options);
+    buildProblem(w, *problem, &landmarks, problem_arena);
+
+    if (marg_arena)
+        marg_arena->reset();
+    MarginalizationInfo *marginalization_info = new MarginalizationInfo(marg_arena);
+    ceres::HuberLoss loss_function(1.0);
+    for (size_t n = 0; n < w.point_obs.size(); n++)
+    {
+        if (w.point_start[n] != 0)
+            continue;
+        const vector<Vector3d> &obs = w.point_obs[n];
+        for (size_t k = 1; k < obs.size(); k++)
+        {
+            ProjectionTwoFrameOneCamFactor *f = marginalization_info->create<ProjectionTwoFrameOneCamFactor>(obs[0], obs[k],
+                Vector2d::Zero(), Vector2d::Zero(), 0.0, 0.0);
+            marginalization_info->addResidualBlockInfo(marginalization_info->create<ResidualBlockInfo>(f, &loss_function,
+                vector<double *>{w.pose[0], w.pose[k], w.ex_pose, &w.inv_depth[n], w.td}, vector<int>{0, 3}));
+        }
+    }
+    marginalization_info->preMarginalize();
+    marginalization_info->marginalize();
+    delete marginalization_info;
+    delete problem;
+    return heap_allocations - before;
+}
+
+// 两个解的最大差：位置(m)、逆深度(相对)、线的正交表示
+static void compare(const Window &a, const Window &b, double *max_p, double *max_dep, double *max_line)
+{
+    *max_p = *max_dep = *max_line = 0;
+    for (int i = 0; i <= WINDOW_SIZE; i++)
+        *max_p = max(*max_p, (Map<const Vector3d>(a.pose[i]) - Map<const Vector3d>(b.pose[i])).norm());
+    for (size_t n = 0; n < a.inv_depth.size(); n++)
+        *max_dep = max(*max_dep, fabs(a.inv_depth[n] - b.inv_depth[n]) / fabs(a.inv_depth[n]));
+    for (size_t n = 0; n < a.line_orth.size(); n++)
+        *max_line = max(*max_line, (a.line_orth[n] - b.line_orth[n]).norm());
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && string(argv[1]) == "-h")
+    {
+        printf("please intput: rosrun vins solver_benchmark [points, default 150] [lines, default 60] "
+               "[iterations, default 8] [repeat, default 5] \n");
+        return 1;
+    }
+    int num_points = argc > 1 ? atoi(argv[1]) : 150;
+    int num_lines = argc > 2 ? atoi(argv[2]) : 60;
+    int iterations = argc > 3 ? atoi(argv[3]) : 8;
+    int repeat = argc > 4 ? atoi(argv[4]) : 5;
+
+    ProjectionTwoFrameOneCamFactor::sqrt_info = FOCAL_LENGTH / 1.5 * Matrix2d::Identity();
+    lineProjectionFactor::sqrt_info = FOCAL_LENGTH / 1.5 * Matrix2d::Identity();
+
+    Window w;
+    makeWindow(num_points, num_lines, w);
+
+    vector<int> thread_nums;
+    int hw = std::max(1u, std::thread::hardware_concurrency());
+    for (int t = 1; t < hw; t *= 2)
+        thread_nums.push_back(t);
+    thread_nums.push_back(hw);
+
+    printf("%d frames, %d points, %d lines, %d iterations, mean of %d runs\n",
+           WINDOW_SIZE + 1, num_points, num_lines, iterations, repeat);
+    printf("%-8s %10s %12s %12s %12s %8s\n", "threads", "total ms", "jacobian ms", "residual ms", "linear ms", "speedup");
+    double base = 0;
+    for (int t : thread_nums)
+    {
+        double total = 0, jacobian = 0, residual = 0, linear = 0;
+        for (int r = 0; r < repeat; r++)
+        {
+            Window tmp = w;
+            ceres::Solver::Summary summary = solveCeres(tmp, t, iterations, true);
+            total += summary.total_time_in_seconds * 1000;
+            jacobian += summary.jacobian_evaluation_time_in_seconds * 1000;
+            residual += summary.residual_evaluation_time_in_seconds * 1000;
+            linear += summary.linear_solver_time_in_seconds * 1000;
+        }
+        total /= repeat;
+        if (t == 1)
+            base = total;
+        printf("%-8d %10.2f %12.2f %12.2f %12.2f %8.2f\n", t, total,
+               jacobian / repeat, residual / repeat, linear / repeat, base / total);
+    }
+
+    // 单线程下和ceres对比
+    double schur_total = 0;
+    for (int r = 0; r < repeat; r++)
+    {
+        Window tmp = w;
+        schur_total += solveSchur(tmp, iterations, true).total_time_ms;
+    }
+    printf("%-8s %10.2f %12s %12s %12s %8.2f\n", "schur", schur_total / repeat, "-", "-", "-", base / (schur_total / repeat));
+
+    // 都迭代到收敛，结果应该一致
+    Window w_ceres = w, w_schur = w;
+    ceres::Solver::Summary ceres_summary = solveCeres(w_ceres, 1, 100, false);
+    SlidingWindowSolver::Summary schur_summary = solveSchur(w_schur, 100, false);
+    double max_p, max_dep, max_line;
+    compare(w_ceres, w_schur, &max_p, &max_dep, &max_line);
+    printf("converged cost: ceres %.6f (%d iterations), schur %.6f (%d iterations)\n",
+           ceres_summary.final_cost, (int)ceres_summary.iterations.size(),
+           schur_summary.final_cost, schur_summary.iterations);
+    printf("max difference: position %.2e m, inverse depth %.2e, line orth %.2e\n", max_p, max_dep, max_line);
+
+    // 第一帧arena申请内存块，之后应该不再增长
+    FrameArena problem_arena, marg_arena;
+    long heap = frameAllocations(w, nullptr, nullptr);
+    long arena = 0;
+    int chunks = 0;
+    for (int r = 0; r < repeat; r++)
+    {
+        arena = frameAllocations(w, &problem_arena, &marg_arena);
+        int c = problem_arena.heapAllocations() + marg_arena.heapAllocations();
+        if (r > 0 && c != chunks)
+            printf("arena grew in frame %d\n", r);
+        chunks = c;
+    }
+    printf("heap allocations per frame (problem + marginalization): new %ld, arena %ld; arena chunks %d, %.1f MB\n",
+           heap, arena, chunks, (problem_arena.capacity() + marg_arena.capacity()) / 1048576.0);
+    return 0;
+}
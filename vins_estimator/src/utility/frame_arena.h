@@ -0,0 +1,133 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#pragma once
+
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+#include <cstdlib>
+#include <type_traits>
+
+/**
+ * 每帧的小对象(因子、ResidualBlockInfo、雅可比)的线性分配器。
+ * 从大块内存里顺序切出对象，reset时统一析构，内存块留着下一帧复用；
+ * 稳定运行后块数不再增长，heapAllocations()用来确认这一点。不是线程安全的
+ */
+class FrameArena
+{
+  public:
+    explicit FrameArena(size_t chunk_size = 1 << 20) : chunk_size_(chunk_size), current_(0), offset_(0), heap_allocations_(0) {}
+    ~FrameArena()
+    {
+        reset();
+        for (auto &chunk : chunks_)
+            free(chunk.data);
+    }
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    template <typename T, typename... Args>
+    T *create(Args &&... args)
+    {
+        T *object = new (allocateBytes(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+        {
+            if (destructors_.size() == destructors_.capacity())
+                heap_allocations_++;
+            destructors_.push_back(std::make_pair(static_cast<void *>(object), &destroy<T>));
+        }
+        return object;
+    }
+
+    // 未初始化的数组，只用于double、指针这类平凡类型
+    template <typename T>
+    T *allocate(size_t n)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "use create() for objects with destructors");
+        return static_cast<T *>(allocateBytes(n * sizeof(T), alignof(T)));
+    }
+
+    // 析构所有对象，内存块不释放
+    void reset()
+    {
+        for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it)
+            it->second(it->first);
+        destructors_.clear();
+        current_ = 0;
+        offset_ = 0;
+    }
+
+    // 向系统申请内存的次数(内存块和析构表扩容)
+    int heapAllocations() const { return heap_allocations_; }
+    size_t capacity() const
+    {
+        size_t bytes = 0;
+        for (auto &chunk : chunks_)
+            bytes += chunk.size;
+        return bytes;
+    }
+
+  private:
+    struct Chunk
+    {
+        char *data;
+        size_t size;
+    };
+
+    template <typename T>
+    static void destroy(void *object)
+    {
+        static_cast<T *>(object)->~T();
+    }
+
+    void *allocateBytes(size_t bytes, size_t align)
+    {
+        if (align < 16)
+            align = 16;   // Eigen定长矩阵
+        while (true)
+        {
+            if (current_ < chunks_.size())
+            {
+                size_t offset = (offset_ + align - 1) & ~(align - 1);
+                if (offset + bytes <= chunks_[current_].size)
+                {
+                    offset_ = offset + bytes;
+                    return chunks_[current_].data + offset;
+                }
+                if (current_ + 1 < chunks_.size())
+                {
+                    current_++;
+                    offset_ = 0;
+                    continue;
+                }
+            }
+            // 块用完了，申请新块；超大对象单独一块
+            size_t size = std::max(chunk_size_, bytes + align);
+            Chunk chunk;
+            void *data;
+            if (posix_memalign(&data, 64, size) != 0)
+                throw std::bad_alloc();
+            chunk.data = static_cast<char *>(data);
+            chunk.size = size;
+            chunks_.push_back(chunk);
+            heap_allocations_++;
+            current_ = chunks_.size() - 1;
+            offset_ = 0;
+        }
+    }
+
+    size_t chunk_size_;
+    std::vector<Chunk> chunks_;
+    size_t current_, offset_;
+    std::vector<std::pair<void *, void (*)(void *)>> destructors_;
+    int heap_allocations_;
+};
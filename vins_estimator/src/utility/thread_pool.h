@@ -0,0 +1,107 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/**
+ * @brief 固定线程数的简单线程池，前端用它并行跑光流等短任务
+ */
+class ThreadPool
+{
+  public:
+    explicit ThreadPool(int num_threads = 0)
+    {
+        resize(num_threads);
+    }
+
+    ~ThreadPool()
+    {
+        stop();
+    }
+
+    // 重新设置工作线程数，<= 0 表示不开线程（任务在调用线程中同步执行）
+    void resize(int num_threads)
+    {
+        stop();
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = false;
+        for (int i = 0; i < num_threads; i++)
+            workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+
+    int size() const
+    {
+        return static_cast<int>(workers_.size());
+    }
+
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> enqueue(F &&f)
+    {
+        typedef typename std::result_of<F()>::type R;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> res = task->get_future();
+        if (workers_.empty())
+        {
+            (*task)();
+            return res;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            tasks_.emplace([task]() { (*task)(); });
+        }
+        cond_.notify_one();
+        return res;
+    }
+
+  private:
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (stopping_ && tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cond_.notify_all();
+        for (auto &w : workers_)
+            if (w.joinable())
+                w.join();
+        workers_.clear();
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stopping_ = false;
+};
@@ -24,6 +24,7 @@ ros::Publisher pub_keyframe_point;
 ros::Publisher pub_extrinsic;
 
 ros::Publisher pub_image_track;
+ros::Publisher pub_line_track;
 
 CameraPoseVisualization cameraposevisual(1, 0, 0, 1);
 static double sum_of_path = 0;
@@ -48,6 +49,7 @@ void registerPub(ros::NodeHandle &n)
     pub_keyframe_point = n.advertise<sensor_msgs::PointCloud>("keyframe_point", 1000);
     pub_extrinsic = n.advertise<nav_msgs::Odometry>("extrinsic", 1000);
     pub_image_track = n.advertise<sensor_msgs::Image>("image_track", 1000);
+    pub_line_track = n.advertise<sensor_msgs::Image>("line_track", 1000);
 
     cameraposevisual.setScale(0.1);
     cameraposevisual.setLineWidth(0.01);
@@ -80,6 +82,15 @@ void pubTrackImage(const cv::Mat &imgTrack, const double t)
     pub_image_track.publish(imgTrackMsg);
 }
 
+void pubLineTrackImage(const cv::Mat &imgTrack, const double t)
+{
+    std_msgs::Header header;
+    header.frame_id = "world";
+    header.stamp = ros::Time(t);
+    sensor_msgs::ImagePtr imgTrackMsg = cv_bridge::CvImage(header, "bgr8", imgTrack).toImageMsg();
+    pub_line_track.publish(imgTrackMsg);
+}
+
 
 void printStatistics(const Estimator &estimator, double t)
 {
@@ -120,6 +131,10 @@ void printStatistics(const Estimator &estimator, double t)
     sum_of_path += (estimator.Ps[WINDOW_SIZE] - last_path).norm();
     last_path = estimator.Ps[WINDOW_SIZE];
     ROS_DEBUG("sum of path %f", sum_of_path);
+    if (MULTIPLE_THREAD)
+        ROS_DEBUG("frame queue depth %d (max %d), skipped %d, replaced %d of %d frames", estimator.frameQueueDepth.load(),
+                  estimator.frameQueueMaxDepth.load(), estimator.frameSkipCnt.load(), estimator.frameDropCnt.load(),
+                  estimator.inputImageCnt);
     if (ESTIMATE_TD)
         ROS_INFO("td %f", estimator.td);
 }
@@ -128,7 +143,9 @@ void pubOdometry(const Estimator &estimator, const std_msgs::Header &header)
 {
     if (estimator.solver_flag == Estimator::SolverFlag::NON_LINEAR)
     {
-        nav_msgs::Odometry odometry;
+        // loop_fusion订阅的话题都以指针发布，同一个nodelet manager中不需要序列化
+        nav_msgs::OdometryPtr odometry_msg(new nav_msgs::Odometry);
+        nav_msgs::Odometry &odometry = *odometry_msg;
         odometry.header = header;
         odometry.header.frame_id = "world";
         odometry.child_frame_id = "world";
@@ -144,7 +161,7 @@ void pubOdometry(const Estimator &estimator, const std_msgs::Header &header)
         odometry.twist.twist.linear.x = estimator.Vs[WINDOW_SIZE].x();
         odometry.twist.twist.linear.y = estimator.Vs[WINDOW_SIZE].y();
         odometry.twist.twist.linear.z = estimator.Vs[WINDOW_SIZE].z();
-        pub_odometry.publish(odometry);
+        pub_odometry.publish(odometry_msg);
 
         geometry_msgs::PoseStamped pose_stamped;
         pose_stamped.header = header;
@@ -277,7 +294,8 @@ void pubPointCloud(const Estimator &estimator, const std_msgs::Header &header)
 
 
     // pub margined potin
-    sensor_msgs::PointCloud margin_cloud;
+    sensor_msgs::PointCloudPtr margin_cloud_msg(new sensor_msgs::PointCloud);
+    sensor_msgs::PointCloud &margin_cloud = *margin_cloud_msg;
     margin_cloud.header = header;
 
     for (auto &it_per_id : estimator.f_manager.feature)
@@ -303,7 +321,7 @@ void pubPointCloud(const Estimator &estimator, const std_msgs::Header &header)
             margin_cloud.points.push_back(p);
         }
     }
-    pub_margin_cloud.publish(margin_cloud);
+    pub_margin_cloud.publish(margin_cloud_msg);
 }
 
 
@@ -342,7 +360,8 @@ void pubTF(const Estimator &estimator, const std_msgs::Header &header)
     br.sendTransform(tf::StampedTransform(transform, header.stamp, "body", "camera"));
 
     
-    nav_msgs::Odometry odometry;
+    nav_msgs::OdometryPtr odometry_msg(new nav_msgs::Odometry);
+    nav_msgs::Odometry &odometry = *odometry_msg;
     odometry.header = header;
     odometry.header.frame_id = "world";
     odometry.pose.pose.position.x = estimator.tic[0].x();
@@ -353,7 +372,7 @@ void pubTF(const Estimator &estimator, const std_msgs::Header &header)
     odometry.pose.pose.orientation.y = tmp_q.y();
     odometry.pose.pose.orientation.z = tmp_q.z();
     odometry.pose.pose.orientation.w = tmp_q.w();
-    pub_extrinsic.publish(odometry);
+    pub_extrinsic.publish(odometry_msg);
 
 }
 
@@ -367,7 +386,8 @@ void pubKeyframe(const Estimator &estimator)
         Vector3d P = estimator.Ps[i];
         Quaterniond R = Quaterniond(estimator.Rs[i]);
 
-        nav_msgs::Odometry odometry;
+        nav_msgs::OdometryPtr odometry_msg(new nav_msgs::Odometry);
+        nav_msgs::Odometry &odometry = *odometry_msg;
         odometry.header.stamp = ros::Time(estimator.Headers[WINDOW_SIZE - 2]);
         odometry.header.frame_id = "world";
         odometry.pose.pose.position.x = P.x();
@@ -379,10 +399,11 @@ void pubKeyframe(const Estimator &estimator)
         odometry.pose.pose.orientation.w = R.w();
         //printf("time: %f t: %f %f %f r: %f %f %f %f\n", odometry.header.stamp.toSec(), P.x(), P.y(), P.z(), R.w(), R.x(), R.y(), R.z());
 
-        pub_keyframe_pose.publish(odometry);
+        pub_keyframe_pose.publish(odometry_msg);
 
 
-        sensor_msgs::PointCloud point_cloud;
+        sensor_msgs::PointCloudPtr point_cloud_msg(new sensor_msgs::PointCloud);
+        sensor_msgs::PointCloud &point_cloud = *point_cloud_msg;
         point_cloud.header.stamp = ros::Time(estimator.Headers[WINDOW_SIZE - 2]);
         point_cloud.header.frame_id = "world";
         for (auto &it_per_id : estimator.f_manager.feature)
@@ -412,7 +433,7 @@ void pubKeyframe(const Estimator &estimator)
             }
 
         }
-        pub_keyframe_point.publish(point_cloud);
+        pub_keyframe_point.publish(point_cloud_msg);
     }
 }
 
@@ -0,0 +1,43 @@
+/*******************************************************
+ * Copyright (C) 2019, Aerial Robotics Group, Hong Kong University of Science and Technology
+ *
+ * This file is part of VINS.
+ *
+ * Licensed under the GNU General Public License v3.0;
+ * you may not use this file except in compliance with the License.
+ *******************************************************/
+
+#include <ros/ros.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+void startVinsEstimator(ros::NodeHandle &n, const std::string &config_file);
+
+namespace vins
+{
+
+/**
+ * vins_node的nodelet版本，和loop_fusion、相机驱动加载到同一个manager里时话题以指针传递，不做序列化。
+ * 配置文件取nodelet的第一个参数，或私有参数config_file
+ */
+class VinsNodelet : public nodelet::Nodelet
+{
+  private:
+    virtual void onInit()
+    {
+        ros::NodeHandle &n = getPrivateNodeHandle();
+        std::string config_file;
+        if (!getMyArgv().empty())
+            config_file = getMyArgv()[0];
+        else if (!n.getParam("config_file", config_file))
+        {
+            NODELET_ERROR("please set the config file: nodelet load vins/VinsNodelet [manager] [config file]");
+            return;
+        }
+        startVinsEstimator(n, config_file);
+    }
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(vins::VinsNodelet, nodelet::Nodelet)